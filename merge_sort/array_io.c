@@ -0,0 +1,762 @@
+/*******************************************************************************
+ * @file array_io.c
+ * @brief Input and output files of the sort binaries
+ *
+ * Text files are "n v1 v2 ... vn", as written by create_array : they are
+ * mapped and parsed by all the threads, and formatted by all the threads
+ * with pwrite. Binary files are an array_header_t followed by the raw
+ * values : they are mapped instead of parsed, and a binary output is mapped
+ * before the sort so that the sort itself writes the file.
+ *
+ * Ints have their own parser and formatter, the other types go through
+ * the C library (strtod, snprintf...) one value at a time.
+ ******************************************************************************/
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "array_io.h"
+#include "typed_sort.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "binary array files are read as native little-endian values"
+#endif
+
+/**********************************************
+ * Text output : values formatted per buffer, and longest value
+ * ("-9223372036854775808:-9223372036854775808 ")
+ ***********************************************/
+#define FORMAT_BLOCK (1 << 14)
+#define FORMAT_MAX_LENGTH 48
+
+int array_format = ARRAY_AUTO;
+
+/**********************************************
+ * The shared mapping of the binary output file, if any
+ ***********************************************/
+static void *output_map = NULL;
+static size_t output_map_len;
+
+int parse_array_format(const char *name)
+{
+    if (strcmp(name, "auto") == 0)
+        return ARRAY_AUTO;
+    if (strcmp(name, "text") == 0)
+        return ARRAY_TEXT;
+    if (strcmp(name, "binary") == 0)
+        return ARRAY_BINARY;
+    return -1;
+}
+
+/**********************************************
+ * Names of the types, indexed by ARRAY_INT32 to ARRAY_KV
+ ***********************************************/
+static const char *const type_names[] = {
+    NULL, "int", "int64", "uint32", "float", "double", "kv"};
+
+int parse_array_type(const char *name)
+{
+    for (int type = ARRAY_INT32; type <= ARRAY_KV; type++)
+    {
+        if (strcmp(name, type_names[type]) == 0)
+            return type;
+    }
+    return -1;
+}
+
+size_t array_type_size(int type)
+{
+    switch (type)
+    {
+    case ARRAY_INT32:
+        return sizeof(int);
+    case ARRAY_INT64:
+        return sizeof(int64_t);
+    case ARRAY_UINT32:
+        return sizeof(uint32_t);
+    case ARRAY_FLOAT:
+        return sizeof(float);
+    case ARRAY_DOUBLE:
+        return sizeof(double);
+    case ARRAY_KV:
+        return sizeof(kv_t);
+    }
+    fprintf(stderr, "array_io : unknown type %d\n", type);
+    exit(EXIT_FAILURE);
+}
+
+int array_is_binary(const char *filename)
+{
+    if (array_format != ARRAY_AUTO)
+        return array_format == ARRAY_BINARY;
+
+    const char *ext = strrchr(filename, '.');
+    return ext != NULL && strcmp(ext, ".bin") == 0;
+}
+
+/**********************************************
+ * @brief Maps an input file, read only
+ * @param filename
+ * @param len The length of the file and of the mapping, for munmap
+ * @return The mapping, NULL for an empty file
+ ***********************************************/
+static char *map_input_file(const char *filename, size_t *len)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1)
+    {
+        perror("Error open");
+        exit(EXIT_FAILURE);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        perror("Error fstat");
+        exit(EXIT_FAILURE);
+    }
+
+    *len = st.st_size;
+    if (*len == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    char *map =
+        mmap(NULL, *len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        perror("Error mmap");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    return map;
+}
+
+/**********************************************
+ * @brief Checks the header of a mapped binary file
+ * @return The number of values
+ ***********************************************/
+static int check_header(const char *filename, const char *map, size_t len,
+                        int type)
+{
+    const array_header_t *h = (const array_header_t *)map;
+    if (len < sizeof(array_header_t) || memcmp(h->magic, ARRAY_MAGIC, 4) != 0 ||
+        h->type != (uint32_t)type || h->count > 0x7fffffff ||
+        len < sizeof(array_header_t) + h->count * array_type_size(type))
+    {
+        fprintf(stderr, "%s : not a binary array file of %s\n", filename,
+                type_names[type]);
+        exit(EXIT_FAILURE);
+    }
+    return h->count;
+}
+
+/**********************************************
+ * @brief 1 if the two paths name the same file
+ ***********************************************/
+static int same_file(const char *a, const char *b)
+{
+    struct stat sa, sb;
+    return stat(a, &sa) == 0 && stat(b, &sb) == 0 && sa.st_dev == sb.st_dev &&
+           sa.st_ino == sb.st_ino;
+}
+
+/**********************************************
+ * @brief Creates a binary output file of n values and maps it, shared
+ * @param keep 1 to keep the values already in the file (the input sorted
+ * onto itself), 0 to truncate it first
+ * @return The values of the mapping, after the header
+ ***********************************************/
+static void *map_output_file(const char *filename, int type, int n, int keep)
+{
+    int fd = open(filename, O_RDWR | O_CREAT | (keep ? 0 : O_TRUNC), 0644);
+    if (fd == -1)
+    {
+        perror("Error open");
+        exit(EXIT_FAILURE);
+    }
+
+    output_map_len =
+        sizeof(array_header_t) + (size_t)n * array_type_size(type);
+    if (ftruncate(fd, output_map_len) == -1)
+    {
+        perror("Error ftruncate");
+        exit(EXIT_FAILURE);
+    }
+    output_map = mmap(NULL, output_map_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    if (output_map == MAP_FAILED)
+    {
+        perror("Error mmap");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    array_header_t *h = output_map;
+    memcpy(h->magic, ARRAY_MAGIC, 4);
+    h->type = type;
+    h->count = n;
+    return h + 1;
+}
+
+/**********************************************
+ * @brief 1 for the characters separating two values
+ ***********************************************/
+static inline int is_separator(char c)
+{
+    return (unsigned char)c <= ' ';
+}
+
+/**********************************************
+ * @brief Parses the value starting at p, up to the next separator
+ * @param p The first character of the value
+ * @param end The end of the mapping
+ * @param value The parsed value
+ * @return The separator (or end) following the value
+ *
+ * Eight digits are converted at once (SWAR) when the mapping has room for
+ * an 8-byte load : the digits are found with a mask of the bytes out of
+ * '0'..'9', shifted to the top of the word and combined pairwise by three
+ * multiplications. Anything after the digits, up to the next separator,
+ * is skipped.
+ ***********************************************/
+static inline const char *parse_int(const char *p, const char *end,
+                                    int *value)
+{
+    int negative = 0;
+    if (*p == '-' || *p == '+')
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    long long v = 0;
+    if (end - p >= 8)
+    {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        uint64_t not_digit = ((w + 0x4646464646464646ULL) |
+                              (w - 0x3030303030303030ULL) | w) &
+                             0x8080808080808080ULL;
+        int nd = not_digit ? __builtin_ctzll(not_digit) / 8 : 8;
+        if (nd > 0)
+        {
+            w = (w << (8 * (8 - nd))) & 0x0F0F0F0F0F0F0F0FULL;
+            w = (w * 2561) >> 8;
+            w = ((w & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+            w = ((w & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+            v = w;
+            p += nd;
+        }
+    }
+    while (p < end && (unsigned)(*p - '0') < 10)
+    {
+        v = 10 * v + (*p - '0');
+        p++;
+    }
+    while (p < end && !is_separator(*p))
+    {
+        p++;
+    }
+
+    *value = negative ? -v : v;
+    return p;
+}
+
+/**********************************************
+ * @brief Start of the first value beginning at or after i
+ ***********************************************/
+static size_t next_value(const char *map, size_t len, size_t i)
+{
+    while (i > 0 && i < len && !is_separator(map[i - 1]))
+    {
+        i++; // inside a value started before i
+    }
+    while (i < len && is_separator(map[i]))
+    {
+        i++;
+    }
+    return i;
+}
+
+/**********************************************
+ * @brief Same as parse_int() for the other types
+ * @param value Where the parsed value is stored, of the given type
+ *
+ * The value is copied and terminated for strtoll, strtoul, strtof or
+ * strtod. A record is "key:value".
+ ***********************************************/
+static const char *parse_value(const char *p, const char *end, int type,
+                               void *value)
+{
+    char token[FORMAT_MAX_LENGTH];
+    int len = 0;
+    while (p < end && !is_separator(*p))
+    {
+        if (len < FORMAT_MAX_LENGTH - 1)
+        {
+            token[len++] = *p;
+        }
+        p++;
+    }
+    token[len] = '\0';
+
+    char *rest;
+    switch (type)
+    {
+    case ARRAY_INT64:
+        *(int64_t *)value = strtoll(token, NULL, 10);
+        break;
+    case ARRAY_UINT32:
+        *(uint32_t *)value = strtoul(token, NULL, 10);
+        break;
+    case ARRAY_FLOAT:
+        *(float *)value = strtof(token, NULL);
+        break;
+    case ARRAY_DOUBLE:
+        *(double *)value = strtod(token, NULL);
+        break;
+    case ARRAY_KV:
+        ((kv_t *)value)->key = strtoll(token, &rest, 10);
+        ((kv_t *)value)->value = *rest == ':' ? strtoll(rest + 1, NULL, 10) : 0;
+        break;
+    }
+    return p;
+}
+
+/**********************************************
+ * @brief Reads the values of a mapped text file with all the threads
+ * @param map The file, past its first value (the number of values)
+ * @param len Its length
+ * @param type The type of the values
+ * @param n The number of values
+ * @param T The array receiving them
+ * @return The number of values in the file
+ *
+ * The file is cut in one chunk per thread, every chunk starting at the
+ * start of a value. Each thread counts the values of its chunk, a prefix
+ * sum gives where they go in T, then each thread parses its chunk. Values
+ * beyond n are ignored, a short file leaves the rest of T as it is.
+ ***********************************************/
+static long parse_text(const char *map, size_t len, int type, int n, void *T)
+{
+    int p = omp_get_max_threads();
+    size_t size = array_type_size(type);
+    long offset[p + 1];
+    long total = 0;
+
+#pragma omp parallel num_threads(p)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        size_t lo = next_value(map, len, len * t / nt);
+        size_t hi = next_value(map, len, len * (t + 1) / nt);
+
+        long count = lo < hi; // the first value of the chunk
+#pragma omp simd reduction(+ : count)
+        for (size_t i = lo + 1; i < hi; i++)
+        {
+            // & and not && : no branch, the loop is vectorized
+            count += (!is_separator(map[i])) & is_separator(map[i - 1]);
+        }
+        offset[t + 1] = count;
+#pragma omp barrier
+#pragma omp single
+        {
+            offset[0] = 0;
+            for (int u = 0; u < nt; u++)
+            {
+                offset[u + 1] += offset[u];
+            }
+            total = offset[nt];
+        }
+
+        const char *c = map + lo;
+        for (long k = offset[t]; k < n && c < map + hi; k++)
+        {
+            c = type == ARRAY_INT32
+                    ? parse_int(c, map + len, (int *)T + k)
+                    : parse_value(c, map + len, type, (char *)T + k * size);
+            while (c < map + len && is_separator(*c))
+            {
+                c++;
+            }
+        }
+    }
+    return total;
+}
+
+/**********************************************
+ * @brief Number of characters of the decimal form of x
+ ***********************************************/
+static inline int decimal_length(int x)
+{
+    unsigned u = x < 0 ? -(unsigned)x : (unsigned)x;
+    return 1 + (x < 0) + (u >= 10) + (u >= 100) + (u >= 1000) +
+           (u >= 10000) + (u >= 100000) + (u >= 1000000) + (u >= 10000000) +
+           (u >= 100000000) + (u >= 1000000000);
+}
+
+/**********************************************
+ * @brief Writes x followed by a space, as fprintf("%d ") would
+ * @return The end of the written characters
+ *
+ * Two digits at a time, from a table of "00" to "99".
+ ***********************************************/
+static inline char *format_int(int x, char *out)
+{
+    static const char pairs[201] = "00010203040506070809"
+                                   "10111213141516171819"
+                                   "20212223242526272829"
+                                   "30313233343536373839"
+                                   "40414243444546474849"
+                                   "50515253545556575859"
+                                   "60616263646566676869"
+                                   "70717273747576777879"
+                                   "80818283848586878889"
+                                   "90919293949596979899";
+    unsigned u = x < 0 ? -(unsigned)x : (unsigned)x;
+    if (x < 0)
+    {
+        *out++ = '-';
+    }
+
+    char *q = out + decimal_length(x) - (x < 0);
+    char *stop = q;
+    while (u >= 100)
+    {
+        q -= 2;
+        memcpy(q, pairs + 2 * (u % 100), 2);
+        u /= 100;
+    }
+    if (u >= 10)
+    {
+        q -= 2;
+        memcpy(q, pairs + 2 * u, 2);
+    }
+    else
+    {
+        *--q = '0' + u;
+    }
+    *stop = ' ';
+    return stop + 1;
+}
+
+/**********************************************
+ * @brief Same as format_int() for the other types
+ *
+ * Floats and doubles get the 9 and 17 significant digits that read back to
+ * the same value.
+ ***********************************************/
+static char *format_value(const void *value, int type, char *out)
+{
+    int len = 0;
+    switch (type)
+    {
+    case ARRAY_INT64:
+        len = sprintf(out, "%lld ", (long long)*(const int64_t *)value);
+        break;
+    case ARRAY_UINT32:
+        len = sprintf(out, "%u ", *(const uint32_t *)value);
+        break;
+    case ARRAY_FLOAT:
+        len = sprintf(out, "%.9g ", *(const float *)value);
+        break;
+    case ARRAY_DOUBLE:
+        len = sprintf(out, "%.17g ", *(const double *)value);
+        break;
+    case ARRAY_KV:
+        len = sprintf(out, "%lld:%lld ", (long long)((const kv_t *)value)->key,
+                      (long long)((const kv_t *)value)->value);
+        break;
+    }
+    return out + len;
+}
+
+/**********************************************
+ * @brief Writes the array as text with all the threads
+ * @param fd The output file
+ * @param base Where the text starts in the file
+ * @param type The type of the values
+ * @param n The size of the array
+ * @param T The array
+ *
+ * Each thread measures the text of its slice of T, a prefix sum gives
+ * where it goes in the file, then each thread formats its slice
+ * FORMAT_BLOCK values at a time in its own buffer and writes every buffer
+ * at its offset with pwrite. The values other than ints are measured by
+ * formatting them.
+ ***********************************************/
+static void format_text(int fd, off_t base, int type, int n,
+                        const void *T)
+{
+    int p = omp_get_max_threads();
+    size_t value_size = array_type_size(type);
+    const int *Ti = T;
+    const char *Tc = T;
+    off_t offset[p + 1];
+
+#pragma omp parallel num_threads(p)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int lo = (long long)n * t / nt;
+        int hi = (long long)n * (t + 1) / nt;
+
+        off_t size = 0;
+        if (type == ARRAY_INT32)
+        {
+            for (int i = lo; i < hi; i++)
+            {
+                size += decimal_length(Ti[i]) + 1;
+            }
+        }
+        else
+        {
+            char scratch[FORMAT_MAX_LENGTH];
+            for (int i = lo; i < hi; i++)
+            {
+                size += format_value(Tc + i * value_size, type, scratch) -
+                        scratch;
+            }
+        }
+        offset[t + 1] = size;
+#pragma omp barrier
+#pragma omp single
+        {
+            offset[0] = base;
+            for (int u = 0; u < nt; u++)
+            {
+                offset[u + 1] += offset[u];
+            }
+        }
+
+        char *buf = malloc(FORMAT_BLOCK * FORMAT_MAX_LENGTH);
+        if (buf == NULL)
+        {
+            perror("malloc : format buffer error");
+            exit(EXIT_FAILURE);
+        }
+        off_t at = offset[t];
+        for (int i = lo; i < hi; i += FORMAT_BLOCK)
+        {
+            int block_end = hi - i < FORMAT_BLOCK ? hi : i + FORMAT_BLOCK;
+            char *end = buf;
+            for (int j = i; j < block_end; j++)
+            {
+                end = type == ARRAY_INT32
+                          ? format_int(Ti[j], end)
+                          : format_value(Tc + j * value_size, type, end);
+            }
+            for (char *w = buf; w < end;)
+            {
+                ssize_t written = pwrite(fd, w, end - w, at);
+                if (written == -1)
+                {
+                    perror("Error pwrite");
+                    exit(EXIT_FAILURE);
+                }
+                w += written;
+                at += written;
+            }
+        }
+        free(buf);
+    }
+}
+
+void read_array(char *input, char *output, int type, int *array_size,
+                void **T)
+{
+    size_t len;
+    char *map = map_input_file(input, &len);
+    size_t size = array_type_size(type);
+
+    /**********************************************
+     * Number of values, and where they start
+     ***********************************************/
+    size_t body;
+    if (array_is_binary(input))
+    {
+        *array_size = check_header(input, map, len, type);
+        body = sizeof(array_header_t);
+    }
+    else
+    {
+        size_t i = next_value(map, len, 0);
+        if (i == len || (unsigned)(map[i] - '0') >= 10)
+        {
+            fprintf(stderr, "%s : missing array size\n", input);
+            exit(EXIT_FAILURE);
+        }
+        const char *end = parse_int(map + i, map + len, array_size);
+        body = next_value(map, len, end - map);
+    }
+
+    /**********************************************
+     * A binary output is mapped, unless it is the input file itself and
+     * the input is text : the output would be truncated before the values
+     * are parsed. A binary input sorted onto itself is already in place.
+     ***********************************************/
+    int mapped = output != NULL && array_is_binary(output);
+    int in_place = mapped && same_file(input, output);
+    if (in_place && !array_is_binary(input))
+    {
+        mapped = in_place = 0;
+    }
+    *T = mapped ? map_output_file(output, type, *array_size, in_place)
+                : malloc(*array_size * size);
+    if (*T == NULL)
+    {
+        perror("malloc : T error for argc == 3");
+        exit(EXIT_FAILURE);
+    }
+
+    /**********************************************
+     * Values
+     ***********************************************/
+    if (in_place)
+    {
+        // the values are already after the header of the mapping
+    }
+    else if (array_is_binary(input))
+    {
+        memcpy(*T, map + body, *array_size * size);
+    }
+    else
+    {
+        long count = parse_text(map + body, len - body, type, *array_size, *T);
+        if (count < *array_size)
+        {
+            fprintf(stderr, "%s : %ld values, %d announced\n", input, count,
+                    *array_size);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (map != NULL)
+    {
+        munmap(map, len);
+    }
+}
+
+void read_input_file(char *input, char *output, int *array_size, int **T)
+{
+    read_array(input, output, ARRAY_INT32, array_size, (void **)T);
+}
+
+void write_array(char *filename, int type, int array_size, void *T)
+{
+    if (output_map != NULL && T == (array_header_t *)output_map + 1)
+    {
+        return; // sorted in place in the mapping of the file
+    }
+
+    if (array_is_binary(filename))
+    {
+        memcpy(map_output_file(filename, type, array_size, 0), T,
+               array_size * array_type_size(type));
+        munmap(output_map, output_map_len);
+        output_map = NULL;
+        return;
+    }
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        perror("Error open");
+        exit(EXIT_FAILURE);
+    }
+    format_text(fd, 0, type, array_size, T);
+
+    close(fd);
+}
+
+void write_output_file(char *filename, int array_size, int *T)
+{
+    write_array(filename, ARRAY_INT32, array_size, T);
+}
+
+void write_input_file(char *filename, int type, int array_size, void *T)
+{
+    if (array_is_binary(filename))
+    {
+        write_array(filename, type, array_size, T); // the header has n
+        return;
+    }
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        perror("Error open");
+        exit(EXIT_FAILURE);
+    }
+    char count[FORMAT_MAX_LENGTH];
+    int len = format_int(array_size, count) - count;
+    if (pwrite(fd, count, len, 0) != len)
+    {
+        perror("Error pwrite");
+        exit(EXIT_FAILURE);
+    }
+    format_text(fd, len, type, array_size, T);
+
+    close(fd);
+}
+
+long array_file_size(const char *filename)
+{
+    struct stat st;
+    return stat(filename, &st) == 0 ? st.st_size : 0;
+}
+
+void free_array(void *T)
+{
+    if (output_map != NULL && T == (array_header_t *)output_map + 1)
+    {
+        munmap(output_map, output_map_len); // writes the file back
+        output_map = NULL;
+        return;
+    }
+    free(T);
+}
+
+void pretty_print_array(int *tab, int n)
+{
+    printf("[");
+    if (n <= 1000)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            printf("%d", tab[i]);
+            if (i < n - 1)
+            {
+                printf(", ");
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < 100; i++)
+        {
+            printf("%d", tab[i]);
+            if (i < 99)
+            {
+                printf(", ");
+            }
+        }
+        printf(", ... , ");
+        for (int i = n - 100; i < n; i++)
+        {
+            printf("%d", tab[i]);
+            if (i < n - 1)
+            {
+                printf(", ");
+            }
+        }
+    }
+    printf("]\n");
+}
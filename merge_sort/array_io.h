@@ -0,0 +1,136 @@
+/*******************************************************************************
+ * @file array_io.h
+ * @brief Input and output files of the sort binaries : the text format of
+ * create_array, or a raw binary format read and written through mmap
+ ******************************************************************************/
+#ifndef ARRAY_IO_H
+#define ARRAY_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************
+ * @brief Header of a binary array file, followed by count packed
+ * little-endian values of the given type
+ * @arg magic ARRAY_MAGIC
+ * @arg type The type of the values, ARRAY_INT32 to ARRAY_KV
+ * @arg count The number of values
+ ***********************************************/
+typedef struct Array_header
+{
+    char magic[4];
+    uint32_t type;
+    uint64_t count;
+} array_header_t;
+
+#define ARRAY_MAGIC "ARR1"
+
+/**********************************************
+ * Types of the values : int, int64_t, uint32_t, float, double and kv_t
+ * (typed_sort.h), written in text as "key:value"
+ ***********************************************/
+#define ARRAY_INT32 1
+#define ARRAY_INT64 2
+#define ARRAY_UINT32 3
+#define ARRAY_FLOAT 4
+#define ARRAY_DOUBLE 5
+#define ARRAY_KV 6
+
+/**********************************************
+ * Format of the files : chosen from the extension (".bin" is binary), or
+ * forced by the -f option of the binaries
+ ***********************************************/
+#define ARRAY_AUTO 0
+#define ARRAY_TEXT 1
+#define ARRAY_BINARY 2
+
+extern int array_format; // ARRAY_AUTO unless set by -f
+
+/**********************************************
+ * @brief 1 if the file is in the binary format
+ ***********************************************/
+int array_is_binary(const char *filename);
+
+/**********************************************
+ * @brief Parses the argument of -f
+ * @param name "text", "binary" or "auto"
+ * @return The format, -1 if name is unknown
+ ***********************************************/
+int parse_array_format(const char *name);
+
+/**********************************************
+ * @brief Parses the argument of --type
+ * @param name "int", "int64", "uint32", "float", "double" or "kv"
+ * @return The type, -1 if name is unknown
+ ***********************************************/
+int parse_array_type(const char *name);
+
+/**********************************************
+ * @brief Size in bytes of one value of the given type
+ ***********************************************/
+size_t array_type_size(int type);
+
+/**********************************************
+ * @brief Same as read_input_file() for values of any type
+ * @param type The type of the values, the one of a binary input must match
+ * @param output NULL when the array is not the one written, T is then
+ * always allocated
+ ***********************************************/
+void read_array(char *input, char *output, int type, int *array_size,
+                void **T);
+
+/**********************************************
+ * @brief Same as write_output_file() for values of any type
+ ***********************************************/
+void write_array(char *filename, int type, int array_size, void *T);
+
+/**********************************************
+ * @brief Read the given input file and store the values in the array T
+ *
+ * @param input The file to read, text or binary
+ * @param output The file the sorted array will be written to
+ * @param array_size
+ * @param T the array to store the values
+ *
+ * With a binary output, T is a shared mapping of the output file (after
+ * its header) : the sort happens in place in the page cache and
+ * write_output_file() has nothing left to write. A binary input is mapped
+ * and copied, never parsed. A text input with fewer values than its first
+ * number announces is an error.
+ ***********************************************/
+void read_input_file(char *input, char *output, int *array_size, int **T);
+
+/**********************************************
+ * @brief Write the sorted array to the given output file
+ *
+ * @param filename
+ * @param array_size
+ * @param T, the sorted array
+ ***********************************************/
+void write_output_file(char *filename, int array_size, int *T);
+
+/**********************************************
+ * @brief Writes an input file of the sort binaries : as write_array(),
+ * preceded by the number of values in the text format
+ ***********************************************/
+void write_input_file(char *filename, int type, int array_size, void *T);
+
+/**********************************************
+ * @brief Size of a file in bytes, 0 if it cannot be read
+ ***********************************************/
+long array_file_size(const char *filename);
+
+/**********************************************
+ * @brief Releases an array given by read_input_file() or malloc()
+ ***********************************************/
+void free_array(void *T);
+
+/**********************************************
+ * @brief Prints an array of integers, only its first and last 100 values
+ * if it has more than 1000
+ * @param tab The array to print
+ * @param n The size of the array
+ ***********************************************/
+void pretty_print_array(int *tab, int n);
+
+#endif
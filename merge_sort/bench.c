@@ -0,0 +1,408 @@
+/*******************************************************************************
+ * @file bench.c
+ * @brief Benchmark harness of the libpsort backends
+ *
+ * Sweeps input distributions, sizes, backends, algorithms and thread
+ * counts. Every configuration sorts the same input (generator.c) : warmup
+ * runs first, then timed repetitions reported as min, median and 95th
+ * percentile with the median throughput, in CSV or JSON on stdout. Every
+ * run (warmup included) is checked : the output must be sorted and hold the
+ * same values as the input.
+ ******************************************************************************/
+#include <getopt.h>
+#include <omp.h> // for omp_get_wtime
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array_io.h"
+#include "generator.h"
+#include "psort.h"
+
+/**********************************************
+ * Longest lists of sizes, thread counts, backends...
+ ***********************************************/
+#define BENCH_MAX_LIST 64
+
+/**********************************************
+ * Defaults : warmup runs, timed repetitions, size and seed of the input
+ ***********************************************/
+#define BENCH_WARMUP 2
+#define BENCH_REPS 10
+#define BENCH_SIZE (1 << 20)
+#define BENCH_SEED 42
+
+static const char *const backend_names[] = {"sequential", "pthread",
+                                            "openmp"};
+static const char *const algorithm_names[] = {"fusion", "sample",
+                                              "multiway", "adaptive",
+                                              "numa", "inplace", "radix"};
+
+/**********************************************
+ * @brief Timings of one configuration
+ * @arg dist, backend, algorithm, type, threads, n The configuration
+ * @arg min, median, p95 The time of a sort, in seconds
+ ***********************************************/
+typedef struct Bench_result
+{
+    int dist;
+    int backend;
+    int algorithm;
+    const char *type;
+    int threads;
+    int n;
+    double min;
+    double median;
+    double p95;
+} result_t;
+
+/**********************************************
+ * @brief Parses a list of numbers
+ * @param str "a,b,c" or "a:b", a then every doubling up to b
+ * @param list The numbers
+ * @return Their number, 0 if str is not a valid list
+ ***********************************************/
+static int parse_list(char *str, int *list)
+{
+    int count = 0;
+    char *colon = strchr(str, ':');
+    if (colon != NULL)
+    {
+        long lo = atol(str);
+        long hi = atol(colon + 1);
+        for (long v = lo; lo > 0 && v <= hi && count < BENCH_MAX_LIST; v *= 2)
+        {
+            list[count++] = v;
+        }
+        return count;
+    }
+
+    for (char *tok = strtok(str, ","); tok != NULL && count < BENCH_MAX_LIST;
+         tok = strtok(NULL, ","))
+    {
+        if (atol(tok) <= 0)
+            return 0;
+        list[count++] = atol(tok);
+    }
+    return count;
+}
+
+/**********************************************
+ * @brief Parses a list of names
+ * @param str "a,b,c"
+ * @param names The known names
+ * @param nb_names Their number
+ * @param list The index of each name of str
+ * @return The number of names of str, 0 if one is unknown
+ ***********************************************/
+static int parse_names(char *str, const char *const *names, int nb_names,
+                       int *list)
+{
+    int count = 0;
+    for (char *tok = strtok(str, ","); tok != NULL && count < BENCH_MAX_LIST;
+         tok = strtok(NULL, ","))
+    {
+        int i = 0;
+        while (i < nb_names && strcmp(tok, names[i]) != 0)
+        {
+            i++;
+        }
+        if (i == nb_names)
+            return 0;
+        list[count++] = i;
+    }
+    return count;
+}
+
+/**********************************************
+ * @brief Sum of the 32-bit words of an array, the same for any order of
+ * its values (they are moved whole and their size is a multiple of 4)
+ ***********************************************/
+static unsigned long long checksum(const void *data, size_t bytes)
+{
+    const unsigned *w = data;
+    long words = bytes / sizeof(unsigned);
+    unsigned long long sum = 0;
+#pragma omp parallel for reduction(+ : sum)
+    for (long i = 0; i < words; i++)
+    {
+        sum += w[i];
+    }
+    return sum;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**********************************************
+ * @brief Runs one configuration
+ * @param input The input, left unchanged
+ * @param work An array of the same size, sorted at each run
+ * @param expected The checksum of input
+ * @param warmup, reps The number of untimed and timed runs
+ * @param r The configuration, receives the timings
+ * @return 0, or -1 if psort_sort() does not support the configuration
+ ***********************************************/
+static int run_config(const void *input, void *work, int type,
+                      unsigned long long expected, int warmup, int reps,
+                      result_t *r)
+{
+    size_t bytes = (size_t)r->n * array_type_size(type);
+    psort_opts_t opts = {.num_threads = r->threads,
+                         .algorithm = r->algorithm};
+    double times[reps];
+
+    if (r->backend == PSORT_PTHREAD)
+    {
+        psort_shutdown(); // the next sort creates a pool of r->threads
+    }
+
+    for (int run = 0; run < warmup + reps; run++)
+    {
+        memcpy(work, input, bytes);
+
+        double start = omp_get_wtime();
+        if (psort_sort(work, r->n, type, r->backend, &opts) != 0)
+            return -1;
+        double stop = omp_get_wtime();
+
+        if (psort_is_sorted(work, r->n, type) != 1 ||
+            checksum(work, bytes) != expected)
+        {
+            fprintf(stderr, "%s %s, %d threads, n = %d : wrong output\n",
+                    backend_names[r->backend], algorithm_names[r->algorithm],
+                    r->threads, r->n);
+            exit(EXIT_FAILURE);
+        }
+        if (run >= warmup)
+        {
+            times[run - warmup] = stop - start;
+        }
+    }
+
+    qsort(times, reps, sizeof(double), compare_double);
+    r->min = times[0];
+    r->median = reps % 2 ? times[reps / 2]
+                         : (times[reps / 2 - 1] + times[reps / 2]) / 2;
+    r->p95 = times[(95 * reps + 99) / 100 - 1]; // nearest rank
+    return 0;
+}
+
+/**********************************************
+ * @brief Prints one result as a CSV line or a JSON object
+ ***********************************************/
+static void print_result(const result_t *r, int json, int first)
+{
+    double throughput = r->n / r->median;
+    if (json)
+    {
+        printf("%s  {\"distribution\": \"%s\", \"backend\": \"%s\", "
+               "\"algorithm\": \"%s\", \"type\": \"%s\", "
+               "\"threads\": %d, \"n\": %d, \"min_s\": %.9g, "
+               "\"median_s\": %.9g, \"p95_s\": %.9g, "
+               "\"elements_per_s\": %.6g}",
+               first ? "" : ",\n", distribution_name(r->dist),
+               backend_names[r->backend], algorithm_names[r->algorithm],
+               r->type, r->threads, r->n, r->min, r->median, r->p95,
+               throughput);
+    }
+    else
+    {
+        printf("%s,%s,%s,%s,%d,%d,%.9g,%.9g,%.9g,%.6g\n",
+               distribution_name(r->dist), backend_names[r->backend],
+               algorithm_names[r->algorithm], r->type, r->threads, r->n,
+               r->min, r->median, r->p95, throughput);
+    }
+    fflush(stdout);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-d distributions] [-b backends] [-a algorithms] "
+            "[-T type] [-n sizes] [-t threads] [-w warmup] [-r reps] "
+            "[-s seed] [-o csv|json]\n",
+            name);
+    fprintf(stderr, "distributions : uniform (default), few, sorted, "
+                    "reverse, nearly, organ, zipf, gauss\n");
+    fprintf(stderr, "backends : sequential,pthread,openmp (default all)\n");
+    fprintf(stderr, "algorithms : fusion,sample,multiway,adaptive,numa,"
+                    "inplace,radix (default fusion, the others for openmp and "
+                    "int only)\n");
+    fprintf(stderr, "type : int (default), int64, uint32, float, double or "
+                    "kv\n");
+    fprintf(stderr, "sizes, threads : a,b,c or a:b (a, 2a, 4a... up to b), "
+                    "default %d and 1:number of processors, then the number "
+                    "of processors\n",
+            BENCH_SIZE);
+    fprintf(stderr, "warmup, reps : default %d and %d\n", BENCH_WARMUP,
+            BENCH_REPS);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    /**********************************************
+     * Initialization
+     ***********************************************/
+    int dists[BENCH_MAX_LIST] = {DIST_UNIFORM};
+    int nb_dists = 1;
+    const char *dist_names[DIST_COUNT];
+    for (int d = 0; d < DIST_COUNT; d++)
+    {
+        dist_names[d] = distribution_name(d);
+    }
+    int backends[BENCH_MAX_LIST] = {PSORT_SEQUENTIAL, PSORT_PTHREAD,
+                                    PSORT_OPENMP};
+    int nb_backends = 3;
+    int algorithms[BENCH_MAX_LIST] = {PSORT_FUSION};
+    int nb_algorithms = 1;
+    int sizes[BENCH_MAX_LIST] = {BENCH_SIZE};
+    int nb_sizes = 1;
+    int threads[BENCH_MAX_LIST];
+    int nb_threads = 0;
+    for (int t = 1; t <= omp_get_num_procs(); t *= 2)
+    {
+        threads[nb_threads++] = t;
+    }
+    if (threads[nb_threads - 1] != omp_get_num_procs())
+    {
+        // the whole machine, 48 after 32 on 48 cores
+        threads[nb_threads++] = omp_get_num_procs();
+    }
+    int type = ARRAY_INT32;
+    const char *type_name = "int";
+    int warmup = BENCH_WARMUP;
+    int reps = BENCH_REPS;
+    unsigned long long seed = BENCH_SEED;
+    int json = 0;
+
+    struct option options[] = {{"distributions", required_argument, NULL, 'd'},
+                               {"backends", required_argument, NULL, 'b'},
+                               {"algorithms", required_argument, NULL, 'a'},
+                               {"type", required_argument, NULL, 'T'},
+                               {"sizes", required_argument, NULL, 'n'},
+                               {"threads", required_argument, NULL, 't'},
+                               {"warmup", required_argument, NULL, 'w'},
+                               {"reps", required_argument, NULL, 'r'},
+                               {"seed", required_argument, NULL, 's'},
+                               {"output", required_argument, NULL, 'o'},
+                               {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:b:a:T:n:t:w:r:s:o:", options,
+                              NULL)) != -1)
+    {
+        int ok = 1;
+        switch (opt)
+        {
+        case 'd':
+            ok = (nb_dists = parse_names(optarg, dist_names, DIST_COUNT,
+                                         dists)) > 0;
+            break;
+        case 'b':
+            ok = (nb_backends = parse_names(optarg, backend_names, 3,
+                                            backends)) > 0;
+            break;
+        case 'a':
+            ok = (nb_algorithms = parse_names(optarg, algorithm_names, 7,
+                                              algorithms)) > 0;
+            break;
+        case 'T':
+            type_name = optarg;
+            ok = (type = parse_array_type(optarg)) > 0;
+            break;
+        case 'n':
+            ok = (nb_sizes = parse_list(optarg, sizes)) > 0;
+            break;
+        case 't':
+            ok = (nb_threads = parse_list(optarg, threads)) > 0;
+            break;
+        case 'w':
+            warmup = atoi(optarg);
+            ok = warmup >= 0;
+            break;
+        case 'r':
+            reps = atoi(optarg);
+            ok = reps > 0;
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'o':
+            json = strcmp(optarg, "json") == 0;
+            ok = json || strcmp(optarg, "csv") == 0;
+            break;
+        default:
+            ok = 0;
+        }
+        if (!ok)
+            usage(argv[0]);
+    }
+    if (optind != argc)
+        usage(argv[0]);
+
+    /**********************************************
+     * Sweep
+     ***********************************************/
+    printf(json ? "[\n"
+                : "distribution,backend,algorithm,type,threads,n,min_s,"
+                  "median_s,p95_s,elements_per_s\n");
+    gen_params_t params = GEN_PARAMS_DEFAULT;
+    int first = 1;
+    for (int input_id = 0; input_id < nb_dists * nb_sizes; input_id++)
+    {
+        int d = input_id / nb_sizes;
+        int i = input_id % nb_sizes;
+        size_t bytes = (size_t)sizes[i] * array_type_size(type);
+        void *input = malloc(bytes);
+        void *work = malloc(bytes);
+        if (input == NULL || work == NULL)
+        {
+            perror("malloc : input error");
+            exit(EXIT_FAILURE);
+        }
+        generate(input, sizes[i], type, dists[d], &params, seed);
+        unsigned long long expected = checksum(input, bytes);
+
+        for (int b = 0; b < nb_backends; b++)
+        {
+            for (int a = 0; a < nb_algorithms; a++)
+            {
+                // the sequential backend runs once, on one thread
+                int nb_t = backends[b] == PSORT_SEQUENTIAL ? 1 : nb_threads;
+                for (int t = 0; t < nb_t; t++)
+                {
+                    result_t r = {dists[d], backends[b], algorithms[a],
+                                  type_name,
+                                  backends[b] == PSORT_SEQUENTIAL ? 1
+                                                                  : threads[t],
+                                  sizes[i], 0, 0, 0};
+                    fprintf(stderr, "%s, %s %s, %d threads, n = %d\n",
+                            distribution_name(r.dist), backend_names[r.backend],
+                            algorithm_names[r.algorithm], r.threads, r.n);
+                    if (run_config(input, work, type, expected, warmup, reps,
+                                   &r) != 0)
+                    {
+                        fprintf(stderr, "  not supported, skipped\n");
+                        continue;
+                    }
+                    print_result(&r, json, first);
+                    first = 0;
+                }
+            }
+        }
+        free(input);
+        free(work);
+    }
+    if (json)
+    {
+        printf("\n]\n");
+    }
+
+    psort_shutdown();
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * @file bench_fusion.c
+ * @brief Measures the per-element cost of the shared fusion kernels (scalar
+ * and the vectorized one picked at runtime) against the former if/else
+ * merge, on random keys.
+ ******************************************************************************/
+#include <omp.h> // for omp_get_wtime
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fusion.h"
+
+#define REPETITIONS 5
+
+/**********************************************
+ * @brief The former merge loop, one data-dependent branch per element
+ * @param U The first sorted array
+ * @param n The size of the first array
+ * @param V The second sorted array
+ * @param m The size of the second array
+ * @param T The resulting merged array
+ ***********************************************/
+void fusion_branch(const int *U, int n, const int *V, int m, int *T)
+{
+    int i = 0, j = 0, k = 0;
+    while (i < n && j < m)
+    {
+        if (U[i] <= V[j])
+        {
+            T[k++] = U[i++];
+        }
+        else
+        {
+            T[k++] = V[j++];
+        }
+    }
+    while (i < n)
+    {
+        T[k++] = U[i++];
+    }
+    while (j < m)
+    {
+        T[k++] = V[j++];
+    }
+}
+
+/**********************************************
+ * @brief Fills tab with sorted random values
+ * @param tab The array to fill
+ * @param n The size of the array
+ ***********************************************/
+void sorted_random_array(int *tab, int n)
+{
+    int x = 0;
+    for (int i = 0; i < n; i++)
+    {
+        x += rand() % 16;
+        tab[i] = x;
+    }
+}
+
+/**********************************************
+ * @brief Best time of REPETITIONS merges, in nanoseconds per element
+ *
+ * U and V are refilled before every run : merging the same data again would
+ * let the branch predictor learn it and hide the mispredicts on small n.
+ ***********************************************/
+double time_merge(void (*merge)(const int *, int, const int *, int, int *),
+                  int *U, int n, int *V, int m, int *T)
+{
+    double best = 0;
+    for (int r = 0; r < REPETITIONS; r++)
+    {
+        sorted_random_array(U, n);
+        sorted_random_array(V, m);
+        double start = omp_get_wtime();
+        merge(U, n, V, m, T);
+        double stop = omp_get_wtime();
+        if (r == 0 || stop - start < best)
+        {
+            best = stop - start;
+        }
+    }
+    return best * 1e9 / (n + m);
+}
+
+/**********************************************
+ * @brief Checks that T[0..n-1] is sorted
+ ***********************************************/
+int is_sorted(const int *T, int n)
+{
+    for (int i = 1; i < n; i++)
+    {
+        if (T[i - 1] > T[i])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    // argc = 1 : ./bench_fusion
+    // argc = 2 : ./bench_fusion <max_size>
+    if (argc > 2)
+    {
+        fprintf(stderr, "Usage: %s [max_size]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    int max_size = argc == 2 ? atoi(argv[1]) : 1 << 24;
+
+    int *U = malloc((max_size / 2) * sizeof(int));
+    int *V = malloc((max_size / 2) * sizeof(int));
+    int *T = malloc(max_size * sizeof(int));
+    if (U == NULL || V == NULL || T == NULL)
+    {
+        perror("malloc : U, V or T error");
+        exit(EXIT_FAILURE);
+    }
+
+    srand(42);
+    printf("fusion kernel: %s\n", fusion_kernel_name());
+    printf("%12s %14s %14s %14s %10s %10s\n", "n", "branch ns/el",
+           "scalar ns/el", "fusion ns/el", "scalar x", "fusion x");
+    for (int n = 1024; n <= max_size; n *= 2)
+    {
+        double t_branch = time_merge(fusion_branch, U, n / 2, V, n / 2, T);
+        double t_scalar = time_merge(fusion_scalar, U, n / 2, V, n / 2, T);
+        if (!is_sorted(T, n))
+        {
+            fprintf(stderr, "fusion_scalar returned an unsorted array for n = %d\n", n);
+            exit(EXIT_FAILURE);
+        }
+        double t_fusion = time_merge(fusion, U, n / 2, V, n / 2, T);
+        if (!is_sorted(T, n))
+        {
+            fprintf(stderr, "fusion returned an unsorted array for n = %d\n", n);
+            exit(EXIT_FAILURE);
+        }
+
+        printf("%12d %14.3f %14.3f %14.3f %9.2fx %9.2fx\n", n, t_branch,
+               t_scalar, t_fusion, t_branch / t_scalar, t_branch / t_fusion);
+    }
+
+    free(U);
+    free(V);
+    free(T);
+    exit(EXIT_SUCCESS);
+}
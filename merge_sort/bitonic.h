@@ -0,0 +1,97 @@
+/*******************************************************************************
+ * @file bitonic.h
+ * @brief In-register bitonic networks on ints (SSE4.1 and AVX2), shared by
+ * the vectorized merge (fusion.c) and the leaf sort (leaf_sort.c).
+ *
+ * Every function carries its own target attribute : the file is compiled
+ * without -mavx2, and callers only reach these functions once CPUID said so.
+ ******************************************************************************/
+#ifndef BITONIC_H
+#define BITONIC_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITONIC_X86
+
+/**********************************************
+ * @brief Sorts a bitonic sequence of 4 ints (SSE4.1)
+ ***********************************************/
+__attribute__((target("sse4.1"))) static inline __m128i
+bitonic_sort_4(__m128i v)
+{
+    __m128i p, mn, mx;
+
+    // distance 2
+    p = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    mn = _mm_min_epi32(v, p);
+    mx = _mm_max_epi32(v, p);
+    v = _mm_blend_epi16(mn, mx, 0xF0);
+
+    // distance 1
+    p = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    mn = _mm_min_epi32(v, p);
+    mx = _mm_max_epi32(v, p);
+    return _mm_blend_epi16(mn, mx, 0xCC);
+}
+
+/**********************************************
+ * @brief Bitonic merge of two sorted registers of 4 ints (SSE4.1)
+ * @param a In : sorted. Out : the 4 smallest values, sorted
+ * @param b In : sorted. Out : the 4 largest values, sorted
+ ***********************************************/
+__attribute__((target("sse4.1"))) static inline void
+bitonic_merge_4x4(__m128i *a, __m128i *b)
+{
+    __m128i rb = _mm_shuffle_epi32(*b, _MM_SHUFFLE(0, 1, 2, 3));
+    __m128i lo = _mm_min_epi32(*a, rb);
+    __m128i hi = _mm_max_epi32(*a, rb);
+    *a = bitonic_sort_4(lo);
+    *b = bitonic_sort_4(hi);
+}
+
+/**********************************************
+ * @brief Sorts a bitonic sequence of 8 ints (AVX2)
+ ***********************************************/
+__attribute__((target("avx2"))) static inline __m256i
+bitonic_sort_8(__m256i v)
+{
+    __m256i p, mn, mx;
+
+    // distance 4
+    p = _mm256_permute2x128_si256(v, v, 0x01);
+    mn = _mm256_min_epi32(v, p);
+    mx = _mm256_max_epi32(v, p);
+    v = _mm256_blend_epi32(mn, mx, 0xF0);
+
+    // distance 2
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    mn = _mm256_min_epi32(v, p);
+    mx = _mm256_max_epi32(v, p);
+    v = _mm256_blend_epi32(mn, mx, 0xCC);
+
+    // distance 1
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    mn = _mm256_min_epi32(v, p);
+    mx = _mm256_max_epi32(v, p);
+    return _mm256_blend_epi32(mn, mx, 0xAA);
+}
+
+/**********************************************
+ * @brief Bitonic merge of two sorted registers of 8 ints (AVX2)
+ * @param a In : sorted. Out : the 8 smallest values, sorted
+ * @param b In : sorted. Out : the 8 largest values, sorted
+ ***********************************************/
+__attribute__((target("avx2"))) static inline void
+bitonic_merge_8x8(__m256i *a, __m256i *b)
+{
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i rb = _mm256_permutevar8x32_epi32(*b, reverse);
+    __m256i lo = _mm256_min_epi32(*a, rb);
+    __m256i hi = _mm256_max_epi32(*a, rb);
+    *a = bitonic_sort_8(lo);
+    *b = bitonic_sort_8(hi);
+}
+
+#endif // BITONIC_X86
+
+#endif
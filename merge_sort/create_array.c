@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * @file create_array.c
+ * @brief Creates an input file of the sort binaries : n followed by n
+ * random values of a given distribution, as text or binary
+ ******************************************************************************/
+#include <getopt.h>
+#include <omp.h> // for omp_get_wtime
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array_io.h"
+#include "generator.h"
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-d distribution] [-T type] [-s seed] [-f format] "
+            "[-u unique] [-w swaps] [-z zipf] [-g sigma] <size_of_array> "
+            "[output_file]\n",
+            name);
+    fprintf(stderr, "distribution is uniform (default), few, sorted, "
+                    "reverse, nearly, organ, zipf or gauss\n");
+    fprintf(stderr, "type is int (default), int64, uint32, float, double or "
+                    "kv\n");
+    fprintf(stderr, "unique : distinct values of few and zipf (16), swaps : "
+                    "fraction swapped by nearly (0.01), zipf : exponent (1), "
+                    "sigma : deviation of gauss (1e6)\n");
+    fprintf(stderr, "output_file defaults to unsorted_array_<size>.txt, "
+                    ".bin with -f binary\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    /**********************************************
+     * Initialization
+     ***********************************************/
+    int dist = DIST_UNIFORM;
+    int type = ARRAY_INT32;
+    uint64_t seed = 42;
+    gen_params_t params = GEN_PARAMS_DEFAULT;
+
+    struct option options[] = {{"distribution", required_argument, NULL, 'd'},
+                               {"type", required_argument, NULL, 'T'},
+                               {"seed", required_argument, NULL, 's'},
+                               {"format", required_argument, NULL, 'f'},
+                               {"unique", required_argument, NULL, 'u'},
+                               {"swaps", required_argument, NULL, 'w'},
+                               {"zipf", required_argument, NULL, 'z'},
+                               {"sigma", required_argument, NULL, 'g'},
+                               {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:T:s:f:u:w:z:g:", options,
+                              NULL)) != -1)
+    {
+        int ok = 1;
+        switch (opt)
+        {
+        case 'd':
+            ok = (dist = parse_distribution(optarg)) >= 0;
+            break;
+        case 'T':
+            ok = (type = parse_array_type(optarg)) > 0;
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'f':
+            ok = (array_format = parse_array_format(optarg)) >= 0;
+            break;
+        case 'u':
+            ok = (params.unique = atoi(optarg)) > 0;
+            break;
+        case 'w':
+            params.swaps = atof(optarg);
+            ok = params.swaps >= 0;
+            break;
+        case 'z':
+            params.zipf = atof(optarg);
+            break;
+        case 'g':
+            params.sigma = atof(optarg);
+            break;
+        default:
+            ok = 0;
+        }
+        if (!ok)
+            usage(argv[0]);
+    }
+    int nb_args = argc - optind;
+    char **args = argv + optind;
+    if (nb_args != 1 && nb_args != 2)
+        usage(argv[0]);
+
+    int array_size = atoi(args[0]);
+    if (array_size < 0)
+        usage(argv[0]);
+
+    char filename[64];
+    if (nb_args == 1)
+    {
+        snprintf(filename, sizeof(filename), "unsorted_array_%d.%s",
+                 array_size, array_format == ARRAY_BINARY ? "bin" : "txt");
+    }
+    char *output = nb_args == 2 ? args[1] : filename;
+
+    /**********************************************
+     * Generation
+     ***********************************************/
+    void *T = malloc((size_t)array_size * array_type_size(type));
+    if (T == NULL && array_size > 0)
+    {
+        perror("malloc : T error");
+        exit(EXIT_FAILURE);
+    }
+
+    double start = omp_get_wtime();
+    generate(T, array_size, type, dist, &params, seed);
+    write_input_file(output, type, array_size, T);
+    double stop = omp_get_wtime();
+
+    printf("%s : %d values, %s, %g s\n", output, array_size,
+           distribution_name(dist), stop - start);
+
+    free(T);
+    exit(EXIT_SUCCESS);
+}
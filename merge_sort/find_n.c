@@ -1,440 +1,233 @@
 /**********************************************
  * @file find_n.c
- * @brief The goal of this program is to find the smallest n such
- * that the parallel version of the merge sort is faster than the
- * sequential version.
+ * @brief Autotuner of the tunables of libpsort on this machine : leaf
+ * size, task cutoff and parallel merge cutoff.
+ *
+ * Each tunable is searched in turn over powers of two, the others fixed
+ * at their best value so far : the leaf size with the sequential sort, the
+ * cutoffs with the OpenMP merge sort. Every timed run sorts a fresh copy of
+ * the same random input. The best values are written to the config file
+ * read by libpsort at startup (psort_config_path()).
  ***********************************************/
 
+#include <getopt.h>
 #include <omp.h> // for omp_get_wtime
-#include <time.h>
 #include <stdio.h>
-#include <unistd.h>
 #include <stdlib.h>
-#include <limits.h>
-#include <pthread.h>
-#include <semaphore.h>
+#include <string.h>
+
+#include "array_io.h"
+#include "generator.h"
+#include "psort.h"
 
 /**********************************************
- * @brief Prints the first 100 and last 100 elements of an array
- * if the array is larger than 1000 elements
- * @param tab The array to print
- * @param n The size of the array
+ * Defaults : size of the input, timed repetitions per candidate, seed
  ***********************************************/
-void pretty_print_array(int *tab, int n)
-{
-    printf("[");
-    if (n <= 1000)
-    {
-        for (int i = 0; i < n; i++)
-        {
-            printf("%d", tab[i]);
-            if (i < n - 1)
-            {
-                printf(", ");
-            }
-        }
-    }
-    else // n > 1000
-    {
-        for (int i = 0; i < 100; i++)
-        {
-            printf("%d, ", tab[i]);
-        }
-        printf(" ... ");
-        for (int i = n - 100; i < n; i++)
-        {
-            printf(", %d", tab[i]);
-        }
-    }
-    printf("]\n");
-}
-
-void fusion_sequential(int *U, int n, int *V, int m, int *T)
-{
-    int i = 0, j = 0;
-    U[n] = INT_MAX;
-    V[m] = INT_MAX;
-    for (int k = 0; k < m + n; k++)
-    {
-        if (U[i] < V[j])
-        {
-            T[k] = U[i++];
-        }
-        else
-        {
-            T[k] = V[j++];
-        }
-    }
-}
-
-void tri_fusion_sequential(int *tab, int n)
-{
-    if (n < 2)
-        return;
-
-    /**********************************************
-     *  Split the array into two parts
-     ***********************************************/
-    int mid = n / 2;
-    int *U = malloc((mid + 1) * sizeof(int));
-    int *V = malloc((n - mid + 1) * sizeof(int));
-    if (U == NULL || V == NULL)
-    {
-        perror("malloc : U or V error");
-        exit(EXIT_FAILURE);
-    }
-
-    for (int i = 0; i < mid; i++)
-    {
-        U[i] = tab[i];
-    }
-    for (int i = 0; i < n - mid; i++)
-    {
-        V[i] = tab[i + mid];
-    }
-    /**********************************************
-     * Sort the two parts + merge them
-     ***********************************************/
-    tri_fusion_sequential(U, mid);
-    tri_fusion_sequential(V, (n - mid));
-    fusion_sequential(U, mid, V, (n - mid), tab);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-// PTHREAD
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-
-sem_t max_depth; // Helps finding the maximum depth of for each thread
+#define TUNE_SIZE (1 << 22)
+#define TUNE_REPS 5
+#define TUNE_SEED 42
 
 /**********************************************
- * @brief Pthread requires a struct to pass multiple arguments to a thread
- * @arg n The size of the array
- * @arg tab The array to sort
+ * @brief Input of the search
+ * @arg input The random array, left unchanged
+ * @arg work The array sorted at each run
+ * @arg n Their size
+ * @arg reps The number of timed runs per candidate
  ***********************************************/
-typedef struct Thread_data
+typedef struct Tune_input
 {
+    const int *input;
+    int *work;
     int n;
-    int *tab;
-} data_t;
+    int reps;
+} tune_input_t;
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
 
 /**********************************************
- * @brief Again, we need to pass multiple arguments to a thread
- * The goal is to do a parallel copy of U and V
- *
- * @arg to_copy The array to copy
- * @arg to_paste The array to paste into
+ * @brief Median time of a sort of the input, after an untimed run
  ***********************************************/
-struct two_data
+static double time_sort(const tune_input_t *in, int backend,
+                        const psort_opts_t *opts)
 {
-    data_t *to_copy;
-    data_t *to_paste;
-};
+    double times[in->reps];
 
-void tri_insertion_pth(data_t t)
-{
-    int n = t.n;
-    for (int i = 1; i < n; i++)
+    for (int run = -1; run < in->reps; run++)
     {
-        int x = t.tab[i];
-        int j = i;
-        while (j > 0 && t.tab[j - 1] > x)
+        memcpy(in->work, in->input, in->n * sizeof(int));
+
+        double start = omp_get_wtime();
+        if (psort_sort(in->work, in->n, PSORT_INT32, backend, opts) != 0)
         {
-            t.tab[j] = t.tab[j - 1];
-            j--;
+            perror("psort_sort");
+            exit(EXIT_FAILURE);
         }
-        t.tab[j] = x;
-    }
-}
-
-int log2floor(int n)
-{
-    if (n == 0 || n == 1)
-        return 0;
-
-    return 1 + log2floor(n >> 1);
-}
+        double stop = omp_get_wtime();
 
-void *copy_array(void *arg)
-{
-    struct two_data *data = (struct two_data *)arg;
-    data_t *to_copy = data->to_copy;
-    data_t *to_paste = data->to_paste;
-    for (int i = 0; i < (to_copy->n) / 2; i++)
-    {
-        to_paste->tab[i] = to_copy->tab[i];
-    }
-    return NULL;
-}
-
-void fusion_pth(data_t u, data_t v, int *T)
-{
-    int i = 0, j = 0;
-    int n = u.n;
-    int m = v.n;
-    u.tab[n] = INT_MAX;
-    v.tab[m] = INT_MAX;
-    for (int k = 0; k < m + n; k++)
-    {
-        if (u.tab[i] < v.tab[j])
+        if (psort_is_sorted(in->work, in->n, PSORT_INT32) != 1)
         {
-            T[k] = u.tab[i++];
+            fprintf(stderr, "wrong output\n");
+            exit(EXIT_FAILURE);
         }
-        else
+        if (run >= 0)
         {
-            T[k] = v.tab[j++];
+            times[run] = stop - start;
         }
     }
+
+    qsort(times, in->reps, sizeof(double), compare_double);
+    return in->reps % 2 ? times[in->reps / 2]
+                        : (times[in->reps / 2 - 1] + times[in->reps / 2]) / 2;
 }
 
-void *tri_fusion_pth(void *arg)
+/**********************************************
+ * @brief Searches one tunable over the powers of two of [lo, hi]
+ * @param name Its name, for the progress lines
+ * @param field The tunable in opts, set to the best value found
+ * @return The median time of the best value
+ ***********************************************/
+static double search(const tune_input_t *in, int backend, psort_opts_t *opts,
+                     int *field, const char *name, int lo, int hi)
 {
-    int value_sem; // Value of the semaphore max_depth
-    data_t *t = (data_t *)arg;
+    int best = *field;
+    double best_time = -1;
 
-    /**********************************************
-     * Base case + Threshold case
-     ***********************************************/
-    if (t->n < 2)
-    {
-        return NULL;
-    }
-    else if (t->n > log2floor(sem_getvalue(&max_depth, &value_sem)))
-    // the insertion threshold
+    for (int value = lo; value <= hi && value > 0; value *= 2)
     {
-        tri_insertion_pth(*t);
-        return NULL;
-    }
-
-    /**********************************************
-     * Starting recursion
-     ***********************************************/
-
-    /**********************************************
-     * Initialization of parallel splitting
-     ***********************************************/
-    int mid = t->n / 2;
-
-    data_t u = {mid, malloc((mid + 1) * sizeof(int))};
-    data_t v = {t->n - mid, malloc((t->n - mid + 1) * sizeof(int))};
-    if (u.tab == NULL || v.tab == NULL)
-    {
-        perror("malloc : u.tab or v.tab error");
-        exit(EXIT_FAILURE);
-    }
-
-    struct two_data u_data = {t, &u};
-    pthread_t copy_u; // Thread to copy the first half of u
-
-    /**********************************************
-     * Parallel splitting
-     ***********************************************/
-
-    // slave thread copies the first half of u
-    if (pthread_create(&copy_u, NULL, copy_array, &u_data) != 0)
-    {
-        perror("pthread_create error");
-        exit(EXIT_FAILURE);
-    }
-    // Master thread copies the second half of v
-    for (int i = 0; i < mid; i++)
-    {
-        v.tab[i] = t->tab[i + mid];
-    }
-    pthread_join(copy_u, NULL);
-
-    /**********************************************
-     * Recursive sorting
-     ***********************************************/
-    pthread_t child;
-
-    // slave thread sorts the first half of u
-    if (pthread_create(&child, NULL, tri_fusion_pth, &u) != 0)
-    {
-        perror("pthread_create error");
-        exit(EXIT_FAILURE);
+        *field = value;
+        double t = time_sort(in, backend, opts);
+        printf("  %s = %d : %g s\n", name, value, t);
+        if (best_time < 0 || t < best_time)
+        {
+            best = value;
+            best_time = t;
+        }
     }
 
-    // Master thread sorts the second half of v
-    tri_fusion_pth(&v);
-
-    /**********************************************
-     * Merging
-     ***********************************************/
-
-    sem_post(&max_depth); // Incrementing the depth
-    pthread_join(child, NULL);
-    fusion_pth(u, v, t->tab);
-    return NULL;
+    *field = best;
+    printf("best %s = %d\n", name, best);
+    return best_time;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-// OPENMP
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-
-#define INSERTION_SORT_THRESHOLD 10000
-
-void tri_insertion(int *tab, int n)
+static void usage(const char *name)
 {
-    for (int i = 1; i < n; i++)
-    {
-        int x = tab[i];
-        int j = i;
-        while (j > 0 && tab[j - 1] > x)
-        {
-            tab[j] = tab[j - 1];
-            j--;
-        }
-        tab[j] = x;
-    }
+    fprintf(stderr,
+            "Usage: %s [-n size] [-r reps] [-s seed] [-t threads] "
+            "[-o config_file] [-p]\n",
+            name);
+    fprintf(stderr, "config_file defaults to $PSORT_CONFIG, then "
+                    "$HOME/.psort.conf ; -p prints the values without "
+                    "writing them\n");
+    exit(EXIT_FAILURE);
 }
 
-void tri_fusion_omp(int *tab, int n)
+int main(int argc, char *argv[])
 {
-
-    /**********************************************
-     * Base case + Threshold case
-     ***********************************************/
-    if (n < 2)
-        return;
-    else if (n <= INSERTION_SORT_THRESHOLD)
-    {
-        tri_insertion(tab, n);
-        return;
-    }
-
     /**********************************************
-     * Starting recursion
+     * Initialization
      ***********************************************/
-
-    /**********************************************
-     * Initialization of parallel splitting
-     ***********************************************/
-    int mid = n / 2;
-    int *U = malloc((mid + 1) * sizeof(int));
-    int *V = malloc((n - mid + 1) * sizeof(int));
-
-    if (U == NULL || V == NULL)
-    {
-        perror("malloc : U or V error");
-        exit(EXIT_FAILURE);
-    }
-
-// Every thread has access to this part of the code
-#pragma omp parallel sections
-    {
-// Master gets one, slave gets the other
-#pragma omp section
-        for (int i = 0; i < mid; i++)
+    int n = TUNE_SIZE;
+    int reps = TUNE_REPS;
+    unsigned long long seed = TUNE_SEED;
+    int num_threads = 0;
+    const char *path = NULL;
+    int dry_run = 0;
+
+    struct option options[] = {{"size", required_argument, NULL, 'n'},
+                               {"reps", required_argument, NULL, 'r'},
+                               {"seed", required_argument, NULL, 's'},
+                               {"threads", required_argument, NULL, 't'},
+                               {"output", required_argument, NULL, 'o'},
+                               {"print", no_argument, NULL, 'p'},
+                               {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:r:s:t:o:p", options, NULL)) !=
+           -1)
+    {
+        int ok = 1;
+        switch (opt)
         {
-            U[i] = tab[i];
-        }
-#pragma omp section
-        for (int i = 0; i < n - mid; i++)
-        {
-            V[i] = tab[i + mid];
+        case 'n':
+            ok = (n = atoi(optarg)) >= 2;
+            break;
+        case 'r':
+            ok = (reps = atoi(optarg)) > 0;
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            ok = (num_threads = atoi(optarg)) > 0;
+            break;
+        case 'o':
+            path = optarg;
+            break;
+        case 'p':
+            dry_run = 1;
+            break;
+        default:
+            ok = 0;
         }
+        if (!ok)
+            usage(argv[0]);
     }
-    /**********************************************
-     * Recursive sorting
-     ***********************************************/
-
-#pragma omp parallel
+    if (optind != argc)
+        usage(argv[0]);
+    if (path == NULL && !dry_run && (path = psort_config_path()) == NULL)
     {
-#pragma omp single
-        {
-// Master thread sorts U, slave V
-#pragma omp task
-            tri_fusion_omp(U, mid);
-            tri_fusion_omp(V, n - mid);
-        }
+        fprintf(stderr, "No config file : set PSORT_CONFIG or use -o\n");
+        exit(EXIT_FAILURE);
     }
-    // implicit barrier
-    fusion_sequential(U, mid, V, n - mid, tab);
 
-    free(U);
-    free(V);
-}
-
-int main(int argc, char *argv[])
-{
-    if (argc != 1)
+    int *input = malloc(n * sizeof(int));
+    int *work = malloc(n * sizeof(int));
+    if (input == NULL || work == NULL)
     {
-        printf("Usage: %s\n", argv[0]);
+        perror("malloc : input error");
         exit(EXIT_FAILURE);
     }
+    gen_params_t params = GEN_PARAMS_DEFAULT;
+    generate(input, n, ARRAY_INT32, DIST_UNIFORM, &params, seed);
+    tune_input_t in = {input, work, n, reps};
 
-    int n = 1;
-    double sequential_time = 0;
-    double parallel_time = 0;
-
-    printf("\nNumber of threads: %d\n", omp_get_max_threads());
-
-    double start, end;
-
-    printf("\nTest for Pthread \n");
-    do
-    {
-        n = n * 2;
-        int *T = malloc(n * sizeof(int));
-        printf("Size of the array: %d\n", n);
-
-        // sequential
-        start = omp_get_wtime();
-        tri_fusion_sequential(T, n);
-        end = omp_get_wtime();
-        sequential_time = end - start;
-
-        printf("Sequential time: %g s\n", sequential_time);
+    printf("n = %d, %d threads\n",
+           n, num_threads > 0 ? num_threads : omp_get_max_threads());
 
-        // pthread
-        data_t init_data = {n, T};
-        sem_init(&max_depth, 0, 0);
-        start = omp_get_wtime();
-        tri_fusion_pth(&init_data);
-        end = omp_get_wtime();
-        parallel_time = end - start;
+    /**********************************************
+     * Search : the tunables not searched yet are 0, the values the
+     * library loaded
+     ***********************************************/
+    psort_opts_t opts = {.num_threads = num_threads};
 
-        printf("Pthread time: %g s\n", parallel_time);
-        free(T);
-    } while (sequential_time < parallel_time);
+    search(&in, PSORT_SEQUENTIAL, &opts, &opts.leaf_size, "leaf_size", 256,
+           1 << 16);
+    search(&in, PSORT_OPENMP, &opts, &opts.task_cutoff, "task_cutoff",
+           opts.leaf_size, n);
+    double best = search(&in, PSORT_OPENMP, &opts,
+                         &opts.parallel_merge_cutoff, "parallel_merge_cutoff",
+                         1 << 12, n);
 
-    printf("\nTest for OpenMP\n");
+    printf("\nleaf_size = %d\ntask_cutoff = %d\nparallel_merge_cutoff = %d\n"
+           "OpenMP merge sort : %g s\n",
+           opts.leaf_size, opts.task_cutoff, opts.parallel_merge_cutoff, best);
 
-    // re-init
-    sequential_time = 0;
-    parallel_time = 0;
-    n = 1;
-    do
+    if (!dry_run)
     {
-        n = n * 2;
-        int *T = malloc(n * sizeof(int));
-        printf("Size of the array: %d\n", n);
-
-        // sequential
-        start = omp_get_wtime();
-        tri_fusion_sequential(T, n);
-        end = omp_get_wtime();
-        sequential_time = end - start;
-
-        printf("Sequential time: %g s\n", sequential_time);
-
-        // omp
-        start = omp_get_wtime();
-        tri_fusion_omp(T, n);
-        end = omp_get_wtime();
-        parallel_time = end - start;
-
-        printf("Omp time: %g s\n", parallel_time);
-        free(T);
-    } while (sequential_time < parallel_time);
+        if (psort_save_config(path, &opts) != 0)
+        {
+            perror(path);
+            exit(EXIT_FAILURE);
+        }
+        printf("Written to %s\n", path);
+    }
 
+    free(input);
+    free(work);
+    psort_shutdown();
     exit(EXIT_SUCCESS);
 }
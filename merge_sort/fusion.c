@@ -0,0 +1,255 @@
+/*******************************************************************************
+ * @file fusion.c
+ * @brief Merge of two sorted arrays : branchless scalar kernel, and SSE4.1 /
+ * AVX2 bitonic merge networks selected at runtime from CPUID.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitonic.h"
+#include "fusion.h"
+
+/**********************************************
+ * @brief Merges two sorted arrays into one sorted array
+ *
+ * Both bounds are checked explicitly and the choice between U[i] and V[j]
+ * is done with a mask instead of an if/else, so random keys no longer cost
+ * a branch mispredict per element. The next head of each side is loaded
+ * before the comparison is known, which keeps the loads off the
+ * compare -> select dependency chain.
+ *
+ * @code
+ * procedure fusion(U[0..n-1],V[0..m-1],T[0..m-1+n-1])
+ * i=j=k=0
+ * tant que i<n et j<m faire
+ *  b = V[j]<U[i]
+ *  T[k++] = b ? V[j] : U[i]
+ *  j += b ; i += 1-b
+ * copier le reste de U puis de V dans T
+ * @endcode
+ ***********************************************/
+void fusion_scalar(const int *U, int n, const int *V, int m, int *T)
+{
+    int i = 0, j = 0, k = 0;
+
+    /**********************************************
+     * Main loop, U[i+1] and V[j+1] always exist
+     ***********************************************/
+    if (n > 0 && m > 0)
+    {
+        int u = U[0];
+        int v = V[0];
+        while (i < n - 1 && j < m - 1)
+        {
+            int u_next = U[i + 1];
+            int v_next = V[j + 1];
+            int mask = -(v < u); // all ones when V[j] is taken
+            T[k++] = (v & mask) | (u & ~mask);
+            i -= ~mask;
+            j -= mask;
+            u = (u & mask) | (u_next & ~mask);
+            v = (v_next & mask) | (v & ~mask);
+        }
+    }
+
+    /**********************************************
+     * Last element of one side
+     ***********************************************/
+    while (i < n && j < m)
+    {
+        int take_v = V[j] < U[i];
+        T[k++] = take_v ? V[j] : U[i];
+        i += 1 - take_v;
+        j += take_v;
+    }
+
+    /**********************************************
+     * Tail of the other side
+     ***********************************************/
+    memcpy(T + k, U + i, (n - i) * sizeof(int));
+    k += n - i;
+    memcpy(T + k, V + j, (m - j) * sizeof(int));
+}
+
+/**********************************************
+ * @brief Finishes a vectorized merge with the scalar kernel
+ * @param w The W sorted values still held in the vector register
+ * @param W The width of the register
+ *
+ * The loop of the vectorized merges stops as soon as one side has less than
+ * W values left. That short side is merged with w first (at most 2W values),
+ * then the result is merged with the long side.
+ ***********************************************/
+static void fusion_tail(const int *w, int W, const int *U, int n, const int *V,
+                        int m, int *T)
+{
+    int x[32];
+    if (n < W)
+    {
+        fusion_scalar(w, W, U, n, x);
+        fusion_scalar(x, W + n, V, m, T);
+    }
+    else
+    {
+        fusion_scalar(w, W, V, m, x);
+        fusion_scalar(U, n, x, W + m, T);
+    }
+}
+
+#ifdef BITONIC_X86
+
+/**********************************************
+ * @brief Merges two sorted arrays 4 values at a time (SSE4.1)
+ *
+ * b keeps the 4 largest values seen so far. At each step the next block of
+ * 4 is loaded from the side whose head is the smallest, merged with b by the
+ * bitonic network, and the 4 smallest values are stored.
+ ***********************************************/
+__attribute__((target("sse4.1"))) static void
+fusion_sse41(const int *U, int n, const int *V, int m, int *T)
+{
+    if (n < 4 || m < 4)
+    {
+        fusion_scalar(U, n, V, m, T);
+        return;
+    }
+
+    __m128i a = _mm_loadu_si128((const __m128i *)U);
+    __m128i b = _mm_loadu_si128((const __m128i *)V);
+    int i = 4, j = 4, k = 0;
+    bitonic_merge_4x4(&a, &b);
+    _mm_storeu_si128((__m128i *)T, a);
+    k += 4;
+
+    while (i <= n - 4 && j <= m - 4)
+    {
+        int take_v = V[j] < U[i];
+        const int *next = take_v ? V + j : U + i;
+        i += take_v ? 0 : 4;
+        j += take_v ? 4 : 0;
+        a = _mm_loadu_si128((const __m128i *)next);
+        bitonic_merge_4x4(&a, &b);
+        _mm_storeu_si128((__m128i *)(T + k), a);
+        k += 4;
+    }
+
+    int w[4];
+    _mm_storeu_si128((__m128i *)w, b);
+    fusion_tail(w, 4, U + i, n - i, V + j, m - j, T + k);
+}
+
+/**********************************************
+ * @brief Merges two sorted arrays 8 values at a time (AVX2)
+ *
+ * Same scheme as fusion_sse41 with 8-wide registers.
+ ***********************************************/
+__attribute__((target("avx2"))) static void
+fusion_avx2(const int *U, int n, const int *V, int m, int *T)
+{
+    if (n < 8 || m < 8)
+    {
+        fusion_scalar(U, n, V, m, T);
+        return;
+    }
+
+    __m256i a = _mm256_loadu_si256((const __m256i *)U);
+    __m256i b = _mm256_loadu_si256((const __m256i *)V);
+    int i = 8, j = 8, k = 0;
+    bitonic_merge_8x8(&a, &b);
+    _mm256_storeu_si256((__m256i *)T, a);
+    k += 8;
+
+    while (i <= n - 8 && j <= m - 8)
+    {
+        int take_v = V[j] < U[i];
+        const int *next = take_v ? V + j : U + i;
+        i += take_v ? 0 : 8;
+        j += take_v ? 8 : 0;
+        a = _mm256_loadu_si256((const __m256i *)next);
+        bitonic_merge_8x8(&a, &b);
+        _mm256_storeu_si256((__m256i *)(T + k), a);
+        k += 8;
+    }
+
+    int w[8];
+    _mm256_storeu_si256((__m256i *)w, b);
+    fusion_tail(w, 8, U + i, n - i, V + j, m - j, T + k);
+}
+
+#endif // BITONIC_X86
+
+/**********************************************
+ * @brief Co-rank of k in the merge of U and V
+ *
+ * For i elements taken from U and j = k - i from V to be the k first merged
+ * ones, U[i-1] <= V[j] and V[j-1] < U[i] must hold. The second predicate is
+ * monotone in i, the smallest i verifying it also verifies the first one.
+ ***********************************************/
+int co_rank(int k, const int *U, int n, const int *V, int m)
+{
+    int lo = (k > m) ? k - m : 0;
+    int hi = (k < n) ? k : n;
+    while (lo < hi)
+    {
+        int i = lo + (hi - lo) / 2;
+        if (U[i] > V[k - i - 1])
+        {
+            hi = i;
+        }
+        else
+        {
+            lo = i + 1;
+        }
+    }
+    return lo;
+}
+
+void fusion_slice(int k0, int k1, const int *U, int n, const int *V, int m,
+                  int *T)
+{
+    int i0 = co_rank(k0, U, n, V, m);
+    int i1 = co_rank(k1, U, n, V, m);
+    fusion(U + i0, i1 - i0, V + (k0 - i0), (k1 - k0) - (i1 - i0), T + k0);
+}
+
+/**********************************************
+ * Kernel used by fusion(), chosen once at load time
+ ***********************************************/
+typedef void (*fusion_fn)(const int *, int, const int *, int, int *);
+
+static fusion_fn fusion_kernel = fusion_scalar;
+static const char *fusion_kernel_label = "scalar";
+
+/**********************************************
+ * @brief Picks the widest merge network the CPU supports
+ *
+ * Runs before main(), so fusion() can be called from any thread without
+ * synchronisation.
+ ***********************************************/
+__attribute__((constructor)) static void fusion_init(void)
+{
+#ifdef BITONIC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        fusion_kernel = fusion_avx2;
+        fusion_kernel_label = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse4.1"))
+    {
+        fusion_kernel = fusion_sse41;
+        fusion_kernel_label = "sse4.1";
+    }
+#endif
+}
+
+const char *fusion_kernel_name(void)
+{
+    return fusion_kernel_label;
+}
+
+void fusion(const int *U, int n, const int *V, int m, int *T)
+{
+    fusion_kernel(U, n, V, m, T);
+}
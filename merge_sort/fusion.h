@@ -0,0 +1,70 @@
+/*******************************************************************************
+ * @file fusion.h
+ * @brief Merge kernel shared by every merge sort of this directory
+ ******************************************************************************/
+#ifndef FUSION_H
+#define FUSION_H
+
+/**********************************************
+ * @brief Merges two sorted arrays into one sorted array
+ * @param U The first sorted array
+ * @param n The size of the first array
+ * @param V The second sorted array
+ * @param m The size of the second array
+ * @param T The resulting merged array, must not overlap U or V
+ *
+ * No sentinel is written, U and V can be adjacent slices of one buffer and
+ * hold any int value (INT_MAX included). Dispatches to the AVX2 or SSE4.1
+ * bitonic merge when the CPU has it, to fusion_scalar otherwise.
+ ***********************************************/
+void fusion(const int *U, int n, const int *V, int m, int *T);
+
+/**********************************************
+ * @brief Branchless scalar merge, the fallback of fusion()
+ *
+ * Same contract as fusion(), equal keys are taken from U first.
+ ***********************************************/
+void fusion_scalar(const int *U, int n, const int *V, int m, int *T);
+
+/**********************************************
+ * Default number of merged elements from which the parallel sorts split a
+ * merge between threads
+ ***********************************************/
+#ifndef PARALLEL_MERGE_CUTOFF
+#define PARALLEL_MERGE_CUTOFF (1 << 17)
+#endif
+
+/**********************************************
+ * @brief Parallel merge cutoff used by the sorts, PARALLEL_MERGE_CUTOFF
+ * unless the config file or the PARALLEL_MERGE_CUTOFF environment variable
+ * overrides it (tunables.c)
+ ***********************************************/
+extern int parallel_merge_cutoff;
+
+/**********************************************
+ * @brief Co-rank of k in the merge of U and V (merge path)
+ * @param k A position in the merged array, 0 <= k <= n + m
+ * @return The number i of elements of U among the k first merged elements,
+ * the other k - i come from V
+ *
+ * Binary search of the smallest i such that V[k-i-1] < U[i], consistent
+ * with fusion() taking equal keys from U first.
+ ***********************************************/
+int co_rank(int k, const int *U, int n, const int *V, int m);
+
+/**********************************************
+ * @brief Writes T[k0..k1-1] of the merge of U and V
+ *
+ * Slices with disjoint [k0, k1) can be merged by different threads, each
+ * one finds its inputs with co_rank().
+ ***********************************************/
+void fusion_slice(int k0, int k1, const int *U, int n, const int *V, int m,
+                  int *T);
+
+/**********************************************
+ * @brief Name of the kernel selected by fusion() : "avx2", "sse4.1" or
+ * "scalar"
+ ***********************************************/
+const char *fusion_kernel_name(void);
+
+#endif
@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * @file generator.c
+ * @brief Random arrays of the distributions met in practice
+ *
+ * The i-th random number is a hash (splitmix64) of the seed and of i : no
+ * generator state is shared, each thread fills its own indices and the
+ * array does not depend on the number of threads.
+ ******************************************************************************/
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array_io.h"
+#include "generator.h"
+#include "typed_sort.h"
+
+static const char *const dist_names[DIST_COUNT] = {
+    "uniform", "few", "sorted", "reverse", "nearly", "organ", "zipf", "gauss"};
+
+const char *distribution_name(int dist)
+{
+    return dist_names[dist];
+}
+
+int parse_distribution(const char *name)
+{
+    for (int dist = 0; dist < DIST_COUNT; dist++)
+    {
+        if (strcmp(name, dist_names[dist]) == 0)
+            return dist;
+    }
+    return -1;
+}
+
+/**********************************************
+ * @brief The i-th random 64-bit number of a stream (splitmix64)
+ ***********************************************/
+static inline uint64_t random_at(uint64_t seed, uint64_t i)
+{
+    uint64_t z = seed + (i + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**********************************************
+ * @brief A random double in [0, 1)
+ ***********************************************/
+static inline double unit(uint64_t r)
+{
+    return (r >> 11) * 0x1.0p-53;
+}
+
+/**********************************************
+ * @brief Stores an integer value at T[i]
+ ***********************************************/
+static inline void put(void *T, long i, int type, int64_t v)
+{
+    switch (type)
+    {
+    case ARRAY_INT32:
+        ((int *)T)[i] = (int)v;
+        break;
+    case ARRAY_INT64:
+        ((int64_t *)T)[i] = v;
+        break;
+    case ARRAY_UINT32:
+        ((uint32_t *)T)[i] = (uint32_t)v;
+        break;
+    case ARRAY_FLOAT:
+        ((float *)T)[i] = (float)v;
+        break;
+    case ARRAY_DOUBLE:
+        ((double *)T)[i] = (double)v;
+        break;
+    case ARRAY_KV:
+        ((kv_t *)T)[i] = (kv_t){v, i};
+        break;
+    }
+}
+
+/**********************************************
+ * @brief Stores a real value at T[i], rounded for the integer types
+ ***********************************************/
+static inline void put_real(void *T, long i, int type, double d)
+{
+    if (type == ARRAY_FLOAT)
+    {
+        ((float *)T)[i] = (float)d;
+    }
+    else if (type == ARRAY_DOUBLE)
+    {
+        ((double *)T)[i] = d;
+    }
+    else
+    {
+        put(T, i, type, llround(d));
+    }
+}
+
+/**********************************************
+ * @brief Cumulative probabilities of the ranks 1..u of a Zipf law
+ ***********************************************/
+static double *zipf_table(int u, double s)
+{
+    double *cdf = malloc(u * sizeof(double));
+    if (cdf == NULL)
+    {
+        perror("malloc : zipf table error");
+        exit(EXIT_FAILURE);
+    }
+    double sum = 0;
+    for (int k = 0; k < u; k++)
+    {
+        sum += pow(k + 1, -s);
+        cdf[k] = sum;
+    }
+    for (int k = 0; k < u; k++)
+    {
+        cdf[k] /= sum;
+    }
+    return cdf;
+}
+
+/**********************************************
+ * @brief First rank whose cumulative probability reaches x
+ ***********************************************/
+static int zipf_rank(const double *cdf, int u, double x)
+{
+    int lo = 0, hi = u - 1;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (cdf[mid] < x)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**********************************************
+ * @brief Swaps T[a] and T[b], values of size bytes
+ ***********************************************/
+static void swap_values(void *T, long a, long b, size_t size)
+{
+    char tmp[sizeof(kv_t)];
+    char *p = (char *)T + a * size;
+    char *q = (char *)T + b * size;
+    memcpy(tmp, p, size);
+    memcpy(p, q, size);
+    memcpy(q, tmp, size);
+}
+
+void generate(void *T, int n, int type, int dist, const gen_params_t *params,
+              uint64_t seed)
+{
+    int u = params->unique > 0 ? params->unique : 1;
+    double *cdf = dist == DIST_ZIPF ? zipf_table(u, params->zipf) : NULL;
+    int real = type == ARRAY_FLOAT || type == ARRAY_DOUBLE;
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++)
+    {
+        uint64_t r = random_at(seed, i);
+        switch (dist)
+        {
+        case DIST_UNIFORM:
+            if (real)
+            {
+                put_real(T, i, type, unit(r));
+            }
+            else
+            {
+                put(T, i, type, (int64_t)r);
+            }
+            break;
+        case DIST_FEW:
+            put(T, i, type, r % u);
+            break;
+        case DIST_SORTED:
+        case DIST_NEARLY:
+            put(T, i, type, i);
+            break;
+        case DIST_REVERSE:
+            put(T, i, type, n - 1 - i);
+            break;
+        case DIST_ORGAN:
+            put(T, i, type, i < n / 2 ? i : n - 1 - i);
+            break;
+        case DIST_ZIPF:
+            put(T, i, type, zipf_rank(cdf, u, unit(r)) + 1);
+            break;
+        case DIST_GAUSS:
+        {
+            // Box-Muller, the second uniform from a second stream
+            double u1 = 1.0 - unit(r);
+            double u2 = unit(random_at(~seed, i));
+            put_real(T, i, type,
+                     params->sigma * sqrt(-2 * log(u1)) * cos(2 * M_PI * u2));
+            break;
+        }
+        }
+    }
+
+    if (dist == DIST_NEARLY && n > 1)
+    {
+        // sequential : the swaps may touch the same values
+        long swaps = params->swaps * n;
+        size_t size = array_type_size(type);
+        for (long s = 0; s < swaps; s++)
+        {
+            uint64_t r = random_at(seed ^ 0x5DEECE66DULL, s);
+            swap_values(T, (r >> 32) % n, (uint32_t)r % n, size);
+        }
+    }
+    free(cdf);
+}
@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * @file generator.h
+ * @brief Random arrays of the distributions met in practice, for
+ * create_array and the benchmarks
+ ******************************************************************************/
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdint.h>
+
+/**********************************************
+ * Distributions
+ ***********************************************/
+#define DIST_UNIFORM 0 // every value of the type ([0, 1) for floats)
+#define DIST_FEW 1     // unique distinct values
+#define DIST_SORTED 2  // 0, 1, ..., n - 1
+#define DIST_REVERSE 3 // n - 1, ..., 1, 0
+#define DIST_NEARLY 4  // sorted, then swaps * n random swaps
+#define DIST_ORGAN 5   // 0, 1, ..., n / 2, ..., 1, 0 (organ pipe)
+#define DIST_ZIPF 6    // rank k of unique ones with probability ~ 1 / k^zipf
+#define DIST_GAUSS 7   // normal, mean 0, standard deviation sigma
+#define DIST_COUNT 8
+
+/**********************************************
+ * @brief Parameters of the distributions
+ * @arg unique The number of distinct values of DIST_FEW and DIST_ZIPF
+ * @arg swaps The fraction of values swapped by DIST_NEARLY
+ * @arg zipf The exponent of DIST_ZIPF
+ * @arg sigma The standard deviation of DIST_GAUSS
+ ***********************************************/
+typedef struct Gen_params
+{
+    int unique;
+    double swaps;
+    double zipf;
+    double sigma;
+} gen_params_t;
+
+#define GEN_PARAMS_DEFAULT {16, 0.01, 1.0, 1e6}
+
+/**********************************************
+ * @brief Name of a distribution
+ ***********************************************/
+const char *distribution_name(int dist);
+
+/**********************************************
+ * @brief Parses a distribution name : uniform, few, sorted, reverse,
+ * nearly, organ, zipf or gauss
+ * @return The distribution, -1 if name is unknown
+ ***********************************************/
+int parse_distribution(const char *name);
+
+/**********************************************
+ * @brief Fills an array with all the threads
+ * @param T The array
+ * @param n Its size
+ * @param type Its type, ARRAY_INT32 to ARRAY_KV (records get their index
+ * as value, which shows whether a sort is stable)
+ * @param dist The distribution
+ * @param params Its parameters
+ * @param seed The seed : the same seed gives the same array, whatever the
+ * number of threads
+ ***********************************************/
+void generate(void *T, int n, int type, int dist, const gen_params_t *params,
+              uint64_t seed);
+
+#endif
@@ -0,0 +1,254 @@
+/*******************************************************************************
+ * @file leaf_sort.c
+ * @brief Base case of the merge sorts : sorting networks on blocks of
+ * LEAF_BLOCK ints, then vectorized merge passes up to the leaf size.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitonic.h"
+#include "fusion.h"
+#include "leaf_sort.h"
+
+/**********************************************
+ * @brief Sorts an array of integers using insertion sort
+ * @param tab The array to sort
+ * @param n The size of the array
+ ***********************************************/
+static void tri_insertion(int *tab, int n)
+{
+    for (int i = 1; i < n; i++)
+    {
+        int x = tab[i];
+        int j = i;
+        while (j > 0 && tab[j - 1] > x)
+        {
+            tab[j] = tab[j - 1];
+            j--;
+        }
+        tab[j] = x;
+    }
+}
+
+/**********************************************
+ * @brief Scalar fallback : sorts src[0..LEAF_BLOCK-1] into dst
+ ***********************************************/
+static void sort_block_scalar(const int *src, int *dst)
+{
+    memmove(dst, src, LEAF_BLOCK * sizeof(int));
+    tri_insertion(dst, LEAF_BLOCK);
+}
+
+#ifdef BITONIC_X86
+
+/**********************************************
+ * @brief Compare-exchange of two registers : a = min, b = max
+ ***********************************************/
+#define CMP_SWAP(a, b)                             \
+    do                                             \
+    {                                              \
+        __m256i mn_ = _mm256_min_epi32((a), (b));  \
+        (b) = _mm256_max_epi32((a), (b));          \
+        (a) = mn_;                                 \
+    } while (0)
+
+/**********************************************
+ * @brief Sorts the 8 columns of r[0..7] with the 19 comparators network
+ ***********************************************/
+__attribute__((target("avx2"))) static inline void sort_columns_8(__m256i *r)
+{
+    CMP_SWAP(r[0], r[2]);
+    CMP_SWAP(r[1], r[3]);
+    CMP_SWAP(r[4], r[6]);
+    CMP_SWAP(r[5], r[7]);
+    CMP_SWAP(r[0], r[4]);
+    CMP_SWAP(r[1], r[5]);
+    CMP_SWAP(r[2], r[6]);
+    CMP_SWAP(r[3], r[7]);
+    CMP_SWAP(r[0], r[1]);
+    CMP_SWAP(r[2], r[3]);
+    CMP_SWAP(r[4], r[5]);
+    CMP_SWAP(r[6], r[7]);
+    CMP_SWAP(r[2], r[4]);
+    CMP_SWAP(r[3], r[5]);
+    CMP_SWAP(r[1], r[4]);
+    CMP_SWAP(r[3], r[6]);
+    CMP_SWAP(r[1], r[2]);
+    CMP_SWAP(r[3], r[4]);
+    CMP_SWAP(r[5], r[6]);
+}
+
+/**********************************************
+ * @brief Transposes the 8x8 matrix held in r[0..7]
+ ***********************************************/
+__attribute__((target("avx2"))) static inline void transpose_8x8(__m256i *r)
+{
+    __m256i t[8], u[8];
+    for (int i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (int i = 0; i < 8; i += 4)
+    {
+        u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+/**********************************************
+ * @brief Sorts a bitonic sequence spread over k registers (k = 1, 2 or 4)
+ ***********************************************/
+__attribute__((target("avx2"))) static inline void
+bitonic_sort_regs(__m256i *r, int k)
+{
+    for (int d = k / 2; d > 0; d /= 2)
+    {
+        for (int i = 0; i < k; i++)
+        {
+            if ((i & d) == 0)
+            {
+                CMP_SWAP(r[i], r[i + d]);
+            }
+        }
+    }
+    for (int i = 0; i < k; i++)
+    {
+        r[i] = bitonic_sort_8(r[i]);
+    }
+}
+
+/**********************************************
+ * @brief Bitonic merge of two sorted sequences of k registers
+ * @param a In : sorted. Out : the 8k smallest values, sorted
+ * @param b In : sorted. Out : the 8k largest values, sorted
+ ***********************************************/
+__attribute__((target("avx2"))) static inline void
+bitonic_merge_regs(__m256i *a, __m256i *b, int k)
+{
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i rb[4];
+    for (int i = 0; i < k; i++)
+    {
+        rb[i] = _mm256_permutevar8x32_epi32(b[k - 1 - i], reverse);
+    }
+    for (int i = 0; i < k; i++)
+    {
+        b[i] = _mm256_max_epi32(a[i], rb[i]);
+        a[i] = _mm256_min_epi32(a[i], rb[i]);
+    }
+    bitonic_sort_regs(a, k);
+    bitonic_sort_regs(b, k);
+}
+
+/**********************************************
+ * @brief Sorts src[0..63] into dst without leaving the registers (AVX2)
+ *
+ * The 8 columns are sorted by the network, the transpose turns them into 8
+ * sorted rows, which are then merged 8+8, 16+16 and 32+32.
+ ***********************************************/
+__attribute__((target("avx2"))) static void sort_block_avx2(const int *src,
+                                                            int *dst)
+{
+    __m256i r[8];
+    for (int i = 0; i < 8; i++)
+    {
+        r[i] = _mm256_loadu_si256((const __m256i *)(src + 8 * i));
+    }
+
+    sort_columns_8(r);
+    transpose_8x8(r);
+
+    bitonic_merge_regs(r + 0, r + 1, 1);
+    bitonic_merge_regs(r + 2, r + 3, 1);
+    bitonic_merge_regs(r + 4, r + 5, 1);
+    bitonic_merge_regs(r + 6, r + 7, 1);
+    bitonic_merge_regs(r + 0, r + 2, 2);
+    bitonic_merge_regs(r + 4, r + 6, 2);
+    bitonic_merge_regs(r + 0, r + 4, 4);
+
+    for (int i = 0; i < 8; i++)
+    {
+        _mm256_storeu_si256((__m256i *)(dst + 8 * i), r[i]);
+    }
+}
+
+#endif // BITONIC_X86
+
+/**********************************************
+ * Block sort used by leaf_sort(), chosen once at load time
+ ***********************************************/
+static void (*sort_block)(const int *, int *) = sort_block_scalar;
+
+/**********************************************
+ * @brief Picks the block sort from CPUID
+ ***********************************************/
+__attribute__((constructor)) static void leaf_sort_init(void)
+{
+#ifdef BITONIC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        sort_block = sort_block_avx2;
+    }
+#endif
+}
+
+/**********************************************
+ * @brief Sorts a small array : sorted blocks, then bottom-up merge passes
+ *
+ * The blocks are written in tab or in buf depending on the parity of the
+ * number of merge passes, so that the last pass lands in tab.
+ ***********************************************/
+void leaf_sort(int *tab, int *buf, int n)
+{
+    if (n < 2)
+        return;
+
+    // long : width doubles past n, which may be above 2^30
+    int passes = 0;
+    for (long width = LEAF_BLOCK; width < n; width *= 2)
+    {
+        passes++;
+    }
+    int *from = (passes % 2 == 0) ? tab : buf;
+    int *to = (passes % 2 == 0) ? buf : tab;
+
+    /**********************************************
+     * Sorted blocks, the last one may be shorter
+     ***********************************************/
+    int i = 0;
+    for (; i <= n - LEAF_BLOCK; i += LEAF_BLOCK)
+    {
+        sort_block(tab + i, from + i);
+    }
+    if (i < n)
+    {
+        memmove(from + i, tab + i, (n - i) * sizeof(int));
+        tri_insertion(from + i, n - i);
+    }
+
+    /**********************************************
+     * Merge passes
+     ***********************************************/
+    for (long width = LEAF_BLOCK; width < n; width *= 2)
+    {
+        for (long j = 0; j < n; j += 2 * width)
+        {
+            int left = (n - j < width) ? n - j : width;
+            int right = (n - j - left < width) ? n - j - left : width;
+            fusion(from + j, left, from + j + left, right, to + j);
+        }
+        int *swap = from;
+        from = to;
+        to = swap;
+    }
+}
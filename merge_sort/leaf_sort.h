@@ -0,0 +1,39 @@
+/*******************************************************************************
+ * @file leaf_sort.h
+ * @brief Base case shared by every merge sort of this directory
+ ******************************************************************************/
+#ifndef LEAF_SORT_H
+#define LEAF_SORT_H
+
+/**********************************************
+ * Default number of elements below which tri_fusion stops splitting.
+ * 4096 ints and their scratch buffer (32 KB) stay in the L1/L2 cache.
+ ***********************************************/
+#ifndef LEAF_SIZE
+#define LEAF_SIZE 4096
+#endif
+
+/**********************************************
+ * Size of the blocks sorted in registers before the merge passes
+ ***********************************************/
+#define LEAF_BLOCK 64
+
+/**********************************************
+ * @brief Leaf size used by the sorts, LEAF_SIZE unless the config file or
+ * the LEAF_SIZE environment variable overrides it (tunables.c)
+ ***********************************************/
+extern int leaf_size;
+
+/**********************************************
+ * @brief Sorts a small array (typically n <= leaf_size)
+ * @param tab The array to sort
+ * @param buf A scratch array of n ints, clobbered
+ * @param n The size of the array
+ *
+ * Blocks of LEAF_BLOCK ints are sorted in registers by a sorting network
+ * (AVX2, insertion sort otherwise), then merged two by two with fusion(),
+ * alternating between tab and buf.
+ ***********************************************/
+void leaf_sort(int *tab, int *buf, int n);
+
+#endif
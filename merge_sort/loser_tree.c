@@ -0,0 +1,164 @@
+/*******************************************************************************
+ * @file loser_tree.c
+ * @brief k-way merge with a tournament (loser) tree, and the co-rank that
+ * splits it between threads
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "loser_tree.h"
+
+int loser_tree_init(loser_tree_t *lt, int k, unsigned long long *node)
+{
+    lt->k = loser_tree_leaves(k);
+    lt->node =
+        node != NULL ? node : malloc(3 * lt->k * sizeof(unsigned long long));
+    if (lt->node == NULL)
+        return -1;
+    for (int i = 0; i < 2 * lt->k; i++)
+    {
+        lt->node[i] = LOSER_TREE_EMPTY;
+    }
+    return 0;
+}
+
+/**********************************************
+ * @brief Plays every match, once the keys of the leaves are set
+ *
+ * Bottom-up, with the winners of the level below : the winner of node j
+ * is the smallest of the winners of its two children, the other one is
+ * stored as the loser of j. The winners are kept in the scratch part of
+ * the node array.
+ ***********************************************/
+void loser_tree_build(loser_tree_t *lt)
+{
+    int k = lt->k;
+    unsigned long long *winner = lt->node + 2 * k;
+
+    for (int j = k - 1; j > 0; j--)
+    {
+        unsigned long long a = 2 * j < k ? winner[2 * j] : lt->node[2 * j];
+        unsigned long long b =
+            2 * j + 1 < k ? winner[2 * j + 1] : lt->node[2 * j + 1];
+        winner[j] = a < b ? a : b;
+        lt->node[j] = a < b ? b : a;
+    }
+    lt->node[0] = k > 1 ? winner[1] : lt->node[1];
+}
+
+void loser_tree_destroy(loser_tree_t *lt)
+{
+    free(lt->node);
+}
+
+/**********************************************
+ * @brief Merges k sorted arrays into one sorted array
+ *
+ * The tree lives on the stack : no allocation, so the merge cannot fail
+ * halfway through.
+ *
+ * @code
+ * pour chaque tableau i : feuille i = U[i][0]
+ * tant que l'arbre n'est pas vide
+ *  w = feuille gagnante, T[o++] = sa cle
+ *  feuille w = valeur suivante de U[w] (ou retirer w), rejouer son chemin
+ * @endcode
+ ***********************************************/
+void fusion_k(const int *const *U, const int *n, int k, int *T)
+{
+    loser_tree_t lt;
+    const int *next[k], *end[k];
+    unsigned long long node[3 * loser_tree_leaves(k)];
+
+    loser_tree_init(&lt, k, node);
+    for (int i = 0; i < k; i++)
+    {
+        next[i] = U[i];
+        end[i] = U[i] + n[i];
+        if (n[i] > 0)
+        {
+            loser_tree_set(&lt, i, *next[i]++);
+        }
+    }
+    loser_tree_build(&lt);
+
+    while (!loser_tree_empty(&lt))
+    {
+        int w = loser_tree_winner(&lt);
+        *T++ = loser_tree_min(&lt);
+        if (next[w] < end[w])
+        {
+            loser_tree_replace(&lt, *next[w]++);
+        }
+        else
+        {
+            loser_tree_pop(&lt);
+        }
+    }
+}
+
+/**********************************************
+ * @brief Number of elements of U[0..n-1] smaller than v (or == v too)
+ ***********************************************/
+static int count_below(const int *U, int n, long long v, int or_equal)
+{
+    int lo = 0, hi = n;
+    while (lo < hi)
+    {
+        int i = lo + (hi - lo) / 2;
+        if (U[i] < v || (or_equal && U[i] == v))
+        {
+            lo = i + 1;
+        }
+        else
+        {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+/**********************************************
+ * @brief Co-rank of r in the merge of k sorted arrays
+ *
+ * Binary search on the values of the smallest v having at least r
+ * elements <= v : every element < v is taken, then the missing ones among
+ * the elements == v, from the first arrays first. Two positions r0 <= r1
+ * always give pos0[i] <= pos1[i].
+ ***********************************************/
+void co_rank_k(long r, const int *const *U, const int *n, int k, int *pos)
+{
+    long long lo = INT_MIN, hi = INT_MAX;
+    while (lo < hi)
+    {
+        long long v = lo + (hi - lo) / 2;
+        long c = 0;
+        for (int i = 0; i < k; i++)
+        {
+            c += count_below(U[i], n[i], v, 1);
+        }
+        if (c >= r)
+        {
+            hi = v;
+        }
+        else
+        {
+            lo = v + 1;
+        }
+    }
+
+    long rest = r;
+    for (int i = 0; i < k; i++)
+    {
+        pos[i] = count_below(U[i], n[i], lo, 0);
+        rest -= pos[i];
+    }
+    for (int i = 0; i < k && rest > 0; i++)
+    {
+        int equal = count_below(U[i], n[i], lo, 1) - pos[i];
+        int take = rest < equal ? rest : equal;
+        pos[i] += take;
+        rest -= take;
+    }
+}
@@ -0,0 +1,160 @@
+/*******************************************************************************
+ * @file loser_tree.h
+ * @brief k-way merge with a tournament (loser) tree
+ ******************************************************************************/
+#ifndef LOSER_TREE_H
+#define LOSER_TREE_H
+
+/**********************************************
+ * Match of an exhausted leaf, greater than any (key, leaf)
+ ***********************************************/
+#define LOSER_TREE_EMPTY (~0ULL)
+
+/**********************************************
+ * @brief A tournament tree over k sorted sequences
+ * @arg k The number of leaves, a power of two
+ * @arg node node[0] is the winner, node[j] for 1 <= j < k the loser of the
+ * match of node j, node[k + i] the current key of the leaf i, node[2k..3k-1]
+ * the scratch of loser_tree_build()
+ *
+ * A match is one 64-bit word : the key (sign bit flipped) above the leaf,
+ * so one unsigned comparison orders the keys and breaks ties by leaf (the
+ * merge is stable). Replacing the key of the winner only replays the
+ * log2(k) matches on its path to the root, each one a min and a max.
+ ***********************************************/
+typedef struct Loser_tree
+{
+    int k;
+    unsigned long long *node;
+} loser_tree_t;
+
+/**********************************************
+ * @brief Number of leaves of a tree over k sequences, its node array
+ * holding 3 times as many matches
+ ***********************************************/
+static inline int loser_tree_leaves(int k)
+{
+    int leaves = 1;
+    while (leaves < k)
+    {
+        leaves *= 2;
+    }
+    return leaves;
+}
+
+/**********************************************
+ * @brief Sets up a tree of at least k leaves, all of them empty
+ * @param node The matches of the tree, 3 loser_tree_leaves(k) of them,
+ * NULL to allocate them (freed by loser_tree_destroy())
+ * @return 0, or -1 if they cannot be allocated
+ ***********************************************/
+int loser_tree_init(loser_tree_t *lt, int k, unsigned long long *node);
+
+/**********************************************
+ * @brief Plays every match, once the keys of the leaves are set
+ ***********************************************/
+void loser_tree_build(loser_tree_t *lt);
+
+/**********************************************
+ * @brief Frees the matches of a tree set up with node NULL
+ ***********************************************/
+void loser_tree_destroy(loser_tree_t *lt);
+
+/**********************************************
+ * @brief Match of the key of a leaf
+ ***********************************************/
+static inline unsigned long long loser_tree_match(int key, int leaf)
+{
+    return (unsigned long long)((unsigned)key ^ 0x80000000u) << 32 |
+           (unsigned)leaf;
+}
+
+/**********************************************
+ * @brief Sets the first key of a leaf, before loser_tree_build()
+ ***********************************************/
+static inline void loser_tree_set(loser_tree_t *lt, int leaf, int key)
+{
+    lt->node[lt->k + leaf] = loser_tree_match(key, leaf);
+}
+
+/**********************************************
+ * @brief 1 once every leaf is exhausted
+ ***********************************************/
+static inline int loser_tree_empty(const loser_tree_t *lt)
+{
+    return lt->node[0] == LOSER_TREE_EMPTY;
+}
+
+/**********************************************
+ * @brief Leaf holding the smallest key
+ ***********************************************/
+static inline int loser_tree_winner(const loser_tree_t *lt)
+{
+    return (unsigned)lt->node[0];
+}
+
+/**********************************************
+ * @brief Smallest key
+ ***********************************************/
+static inline int loser_tree_min(const loser_tree_t *lt)
+{
+    return (int)((unsigned)(lt->node[0] >> 32) ^ 0x80000000u);
+}
+
+/**********************************************
+ * @brief Replays the matches of the winner with its new match
+ ***********************************************/
+static inline void loser_tree_replay(loser_tree_t *lt, unsigned long long w)
+{
+    for (int j = (lt->k + loser_tree_winner(lt)) / 2; j > 0; j /= 2)
+    {
+        // the smaller match goes on, the other one stays as the loser of j
+        unsigned long long l = lt->node[j];
+        lt->node[j] = l > w ? l : w;
+        w = l < w ? l : w;
+    }
+    lt->node[0] = w;
+}
+
+/**********************************************
+ * @brief Replaces the key of the winner by the next key of its sequence
+ ***********************************************/
+static inline void loser_tree_replace(loser_tree_t *lt, int key)
+{
+    loser_tree_replay(lt, loser_tree_match(key, loser_tree_winner(lt)));
+}
+
+/**********************************************
+ * @brief Removes the winner, its sequence is exhausted
+ ***********************************************/
+static inline void loser_tree_pop(loser_tree_t *lt)
+{
+    loser_tree_replay(lt, LOSER_TREE_EMPTY);
+}
+
+/**********************************************
+ * @brief Merges k sorted arrays into one sorted array
+ * @param U The sorted arrays
+ * @param n The size of each array
+ * @param k The number of arrays
+ * @param T The resulting merged array, must not overlap the U[i]
+ *
+ * Equal keys are taken from the first arrays first.
+ ***********************************************/
+void fusion_k(const int *const *U, const int *n, int k, int *T);
+
+/**********************************************
+ * @brief Co-rank of r in the merge of k sorted arrays
+ * @param r A position in the merged array
+ * @param U The sorted arrays
+ * @param n The size of each array
+ * @param k The number of arrays
+ * @param pos The number of elements of each U[i] among the r first merged
+ * ones, sum(pos) = r
+ *
+ * Like co_rank() for two arrays : the slices [co_rank_k(r0), co_rank_k(r1))
+ * of disjoint [r0, r1) can be merged by different threads.
+ ***********************************************/
+void co_rank_k(long r, const int *const *U, const int *n, int k, int *pos);
+
+#endif
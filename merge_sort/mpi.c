@@ -0,0 +1,592 @@
+/*******************************************************************************
+ * @file mpi.c
+ * @brief Distributed sort of ints with MPI, by regular sampling
+ *
+ * Each rank reads one slice of the input and sorts it with the OpenMP merge
+ * sort of libpsort. The ranks then agree on p - 1 splitters drawn from a
+ * regular sample of every sorted slice, exchange their values with
+ * MPI_Alltoallv, and each one merges the p sorted runs it received : rank r
+ * ends up with the r-th part of the output. A binary file is read and
+ * written with MPI-IO, each rank at its own offset, a text file goes
+ * through rank 0.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "array_io.h"
+#include "loser_tree.h"
+#include "psort.h"
+
+/**********************************************
+ * Phases timed, the slowest rank reported
+ ***********************************************/
+#define PHASE_SORT 0
+#define PHASE_SPLIT 1
+#define PHASE_EXCHANGE 2
+#define PHASE_MERGE 3
+#define NB_PHASES 4
+
+/**********************************************
+ * Values sampled per rank and per splitter : more gives parts closer to
+ * total / p, for p^2 OVERSAMPLING values gathered on every rank
+ ***********************************************/
+#define OVERSAMPLING 16
+
+static const char *const phase_names[NB_PHASES] = {"local sort", "splitters",
+                                                   "exchange", "merge"};
+
+/**********************************************
+ * @brief Stops every rank after an error of this one
+ ***********************************************/
+static void fail(const char *filename, const char *message)
+{
+    fprintf(stderr, "%s : %s\n", filename, message);
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+}
+
+/**********************************************
+ * @brief Reads the slice of the input of this rank
+ * @param input A binary file (read with MPI-IO) or a text one (read by rank
+ * 0 and scattered)
+ * @param total Receives the number of values of the file
+ * @param n Receives the size of the slice, total / p values or one more
+ * @param T Receives the slice, to free by the caller
+ ***********************************************/
+static void read_slice(char *input, int *total, int *n, int **T)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    if (array_is_binary(input))
+    {
+        MPI_File fh;
+        if (MPI_File_open(MPI_COMM_WORLD, input, MPI_MODE_RDONLY,
+                          MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+        {
+            fail(input, "cannot be opened");
+        }
+
+        array_header_t header;
+        MPI_File_read_at_all(fh, 0, &header, sizeof(header), MPI_BYTE,
+                             MPI_STATUS_IGNORE);
+        if (memcmp(header.magic, ARRAY_MAGIC, 4) != 0 ||
+            header.type != ARRAY_INT32 || header.count > INT32_MAX)
+        {
+            fail(input, "not a binary file of ints");
+        }
+        *total = header.count;
+
+        long lo = (long)*total * rank / p;
+        long hi = (long)*total * (rank + 1) / p;
+        *n = hi - lo;
+        *T = malloc((*n > 0 ? *n : 1) * sizeof(int));
+        if (*T == NULL)
+        {
+            perror("malloc : T error");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        MPI_File_read_at_all(fh, sizeof(header) + lo * sizeof(int), *T, *n,
+                             MPI_INT, MPI_STATUS_IGNORE);
+        MPI_File_close(&fh);
+        return;
+    }
+
+    void *all = NULL;
+    if (rank == 0)
+    {
+        read_array(input, NULL, ARRAY_INT32, total, &all);
+    }
+    MPI_Bcast(total, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int *counts = malloc(p * sizeof(int));
+    int *displs = malloc(p * sizeof(int));
+    if (counts == NULL || displs == NULL)
+    {
+        perror("malloc : counts error");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int r = 0; r < p; r++)
+    {
+        displs[r] = (long)*total * r / p;
+        counts[r] = (long)*total * (r + 1) / p - displs[r];
+    }
+    *n = counts[rank];
+    *T = malloc((*n > 0 ? *n : 1) * sizeof(int));
+    if (*T == NULL)
+    {
+        perror("malloc : T error");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Scatterv(all, counts, displs, MPI_INT, *T, *n, MPI_INT, 0,
+                 MPI_COMM_WORLD);
+
+    free(counts);
+    free(displs);
+    if (rank == 0)
+    {
+        free_array(all);
+    }
+}
+
+/**********************************************
+ * @brief Writes the part of the output of this rank
+ * @param output A binary file (written with MPI-IO) or a text one (gathered
+ * on rank 0)
+ * @param total The number of values of the output
+ * @param n The size of the part of this rank
+ * @param T The part of this rank, sorted
+ ***********************************************/
+static void write_part(char *output, int total, int n, int *T)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    long offset = 0; // of the part of this rank, in values
+    long part = n;
+    MPI_Exscan(&part, &offset, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0)
+    {
+        offset = 0; // MPI_Exscan leaves it undefined
+    }
+
+    if (array_is_binary(output))
+    {
+        MPI_File fh;
+        if (MPI_File_open(MPI_COMM_WORLD, output,
+                          MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL,
+                          &fh) != MPI_SUCCESS)
+        {
+            fail(output, "cannot be opened");
+        }
+        long body = sizeof(array_header_t);
+        MPI_File_set_size(fh, body + (long)total * sizeof(int));
+
+        if (rank == 0)
+        {
+            array_header_t header = {.type = ARRAY_INT32, .count = total};
+            memcpy(header.magic, ARRAY_MAGIC, 4);
+            MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE,
+                              MPI_STATUS_IGNORE);
+        }
+        MPI_File_write_at_all(fh, body + offset * sizeof(int), T, n, MPI_INT,
+                              MPI_STATUS_IGNORE);
+        MPI_File_close(&fh);
+        return;
+    }
+
+    int *counts = malloc(p * sizeof(int));
+    int *displs = malloc(p * sizeof(int));
+    int *all = rank == 0 ? malloc((total > 0 ? total : 1) * sizeof(int)) : NULL;
+    if (counts == NULL || displs == NULL || (rank == 0 && all == NULL))
+    {
+        perror("malloc : output error");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    int off = offset;
+    MPI_Gather(&n, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gather(&off, 1, MPI_INT, displs, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(T, n, MPI_INT, all, counts, displs, MPI_INT, 0,
+                MPI_COMM_WORLD);
+    if (rank == 0)
+    {
+        write_output_file(output, total, all);
+        free(all);
+    }
+    free(counts);
+    free(displs);
+}
+
+/**********************************************
+ * @brief Number of values of tab[0..n-1] smaller than x (or not greater
+ * than x if or_equal)
+ ***********************************************/
+static int bound(const int *tab, int n, int x, int or_equal)
+{
+    int lo = 0, hi = n;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (or_equal ? tab[mid] <= x : tab[mid] < x)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**********************************************
+ * @brief Chooses the p - 1 splitters of the ranks
+ * @param T The sorted slice of this rank
+ * @param n Its size
+ * @param splitters Receives the splitters, the same on every rank
+ *
+ * Every rank gives min(n, OVERSAMPLING p) values evenly spaced in its
+ * slice, the splitters are evenly spaced in the sorted union of these
+ * samples (regular sampling, PSRS, oversampled : each rank receives at
+ * most about (1 + 1 / OVERSAMPLING) total / p values).
+ ***********************************************/
+static void choose_splitters(const int *T, int n, int *splitters)
+{
+    int p;
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    int s = n < OVERSAMPLING * p ? n : OVERSAMPLING * p;
+    int *sample = malloc(OVERSAMPLING * p * sizeof(int));
+    int *counts = malloc(p * sizeof(int));
+    int *displs = malloc(p * sizeof(int));
+    int *all = malloc((long)OVERSAMPLING * p * p * sizeof(int));
+    if (sample == NULL || counts == NULL || displs == NULL || all == NULL)
+    {
+        perror("malloc : sample error");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int i = 0; i < s; i++)
+    {
+        sample[i] = T[(2L * i + 1) * n / (2 * s)];
+    }
+
+    MPI_Allgather(&s, 1, MPI_INT, counts, 1, MPI_INT, MPI_COMM_WORLD);
+    int nb_samples = 0;
+    for (int r = 0; r < p; r++)
+    {
+        displs[r] = nb_samples;
+        nb_samples += counts[r];
+    }
+    MPI_Allgatherv(sample, s, MPI_INT, all, counts, displs, MPI_INT,
+                   MPI_COMM_WORLD);
+    if (psort_sort(all, nb_samples, PSORT_INT32, PSORT_SEQUENTIAL, NULL) != 0)
+    {
+        perror("psort_sort");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    for (int r = 1; r < p; r++)
+    {
+        // no sample at all : everything goes to the last rank
+        splitters[r - 1] = nb_samples > 0 ? all[(long)nb_samples * r / p]
+                                          : INT32_MAX;
+    }
+
+    free(sample);
+    free(counts);
+    free(displs);
+    free(all);
+}
+
+/**********************************************
+ * @brief Merges the p sorted runs received by this rank, with all its
+ * threads
+ * @param recv The runs, one after the other
+ * @param counts, displs The size and start of each run
+ * @param p The number of runs
+ * @param n Their total size
+ * @return The merged runs, n values to free by the caller
+ *
+ * Thread t writes the slice [n t / nt, n (t + 1) / nt) of the output,
+ * whose values are found in each run by co_rank_k().
+ ***********************************************/
+static int *merge_runs(const int *recv, const int *counts, const int *displs,
+                       int p, int n)
+{
+    int *out = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (out == NULL)
+    {
+        perror("malloc : out error");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        long r0 = (long)n * t / nt;
+        long r1 = (long)n * (t + 1) / nt;
+
+        const int **U = malloc(p * sizeof(int *));
+        int *size = malloc(p * sizeof(int));
+        int *pos0 = malloc(p * sizeof(int));
+        int *pos1 = malloc(p * sizeof(int));
+        if (U == NULL || size == NULL || pos0 == NULL || pos1 == NULL)
+        {
+            perror("malloc : runs error");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+
+        for (int r = 0; r < p; r++)
+        {
+            U[r] = recv + displs[r];
+            size[r] = counts[r];
+        }
+        co_rank_k(r0, U, size, p, pos0);
+        co_rank_k(r1, U, size, p, pos1);
+        for (int r = 0; r < p; r++)
+        {
+            U[r] += pos0[r];
+            size[r] = pos1[r] - pos0[r];
+        }
+        fusion_k(U, size, p, out + r0);
+
+        free(U);
+        free(size);
+        free(pos0);
+        free(pos1);
+    }
+    return out;
+}
+
+/**********************************************
+ * @brief Sorts the values of all the ranks
+ * @param T The slice of this rank, freed
+ * @param n Its size
+ * @param out_n Receives the size of the part of this rank
+ * @param times Receives the time of each phase on this rank
+ * @return The part of this rank of the sorted values
+ *
+ * @code
+ * trier sa tranche (OpenMP)
+ * choisir p - 1 pivots parmi un echantillon regulier de chaque tranche
+ * envoyer au rang r les valeurs entre les pivots r - 1 et r (Alltoallv)
+ * fusionner les p morceaux recus
+ * @endcode
+ ***********************************************/
+static int *tri_mpi(int *T, int n, int *out_n, double *times)
+{
+    int p;
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    double t0 = MPI_Wtime();
+    if (psort_sort(T, n, PSORT_INT32, PSORT_OPENMP, NULL) != 0)
+    {
+        perror("psort_sort");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    double t1 = MPI_Wtime();
+
+    int *splitters = malloc(p * sizeof(int));
+    int *send_counts = malloc(p * sizeof(int));
+    int *send_displs = malloc(p * sizeof(int));
+    int *recv_counts = malloc(p * sizeof(int));
+    int *recv_displs = malloc(p * sizeof(int));
+    if (splitters == NULL || send_counts == NULL || send_displs == NULL ||
+        recv_counts == NULL || recv_displs == NULL)
+    {
+        perror("malloc : counts error");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    choose_splitters(T, n, splitters);
+
+    // rank r receives the values in (splitters[r - 1], splitters[r]] ; the
+    // values equal to splitters a..b, all equal, are shared by the ranks
+    // a..b+1
+    int start = 0;
+    for (int r = 0; r < p; r++)
+    {
+        int end = n;
+        if (r < p - 1)
+        {
+            int a = r, b = r;
+            while (a > 0 && splitters[a - 1] == splitters[r])
+                a--;
+            while (b < p - 2 && splitters[b + 1] == splitters[r])
+                b++;
+            int lo = bound(T, n, splitters[r], 0);
+            int hi = bound(T, n, splitters[r], 1);
+            end = lo + (long)(hi - lo) * (r - a + 1) / (b - a + 2);
+        }
+        send_displs[r] = start;
+        send_counts[r] = end - start;
+        start = end;
+    }
+    double t2 = MPI_Wtime();
+
+    /**********************************************
+     * Exchange
+     ***********************************************/
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+                 MPI_COMM_WORLD);
+    long total = 0;
+    for (int r = 0; r < p; r++)
+    {
+        recv_displs[r] = total;
+        total += recv_counts[r];
+    }
+    if (total > INT32_MAX)
+    {
+        fail("tri_mpi", "too many values on one rank, use more ranks");
+    }
+    int *recv = malloc((total > 0 ? total : 1) * sizeof(int));
+    if (recv == NULL)
+    {
+        perror("malloc : recv error");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Alltoallv(T, send_counts, send_displs, MPI_INT, recv, recv_counts,
+                  recv_displs, MPI_INT, MPI_COMM_WORLD);
+    free(T);
+    double t3 = MPI_Wtime();
+
+    int *out = merge_runs(recv, recv_counts, recv_displs, p, total);
+    double t4 = MPI_Wtime();
+
+    times[PHASE_SORT] = t1 - t0;
+    times[PHASE_SPLIT] = t2 - t1;
+    times[PHASE_EXCHANGE] = t3 - t2;
+    times[PHASE_MERGE] = t4 - t3;
+    *out_n = total;
+
+    free(recv);
+    free(splitters);
+    free(send_counts);
+    free(send_displs);
+    free(recv_counts);
+    free(recv_displs);
+    return out;
+}
+
+/**********************************************
+ * @brief 1 if the parts of all the ranks, one after the other, are sorted
+ ***********************************************/
+static int is_sorted_global(const int *T, int n)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    // the last value of the ranks before, INT32_MIN if they are empty
+    int last = n > 0 ? T[n - 1] : INT32_MIN;
+    int before = INT32_MIN;
+    MPI_Exscan(&last, &before, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (rank == 0)
+    {
+        before = INT32_MIN;
+    }
+
+    int ok = psort_is_sorted(T, n, PSORT_INT32) == 1 &&
+             (n == 0 || before <= T[0]);
+    int all_ok;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return all_ok;
+}
+
+/**
+ * @brief Entry point of the program
+ * @param argc The number of command-line arguments
+ * @param argv The command-line arguments
+ * @return The exit code of the program
+ */
+int main(int argc, char *argv[])
+{
+    /**********************************************
+     * Initialization
+     ***********************************************/
+
+    // mpirun -np N ./mpi [-f format] <input_file> <output_file>
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    struct option options[] = {{"format", required_argument, NULL, 'f'},
+                               {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:", options, NULL)) != -1)
+    {
+        if (opt != 'f' || (array_format = parse_array_format(optarg)) < 0)
+        {
+            argc = 0; // prints the usage below
+            break;
+        }
+    }
+    int nb_args = argc - optind;
+    char **args = argv + optind;
+
+    if (nb_args != 2)
+    {
+        if (rank == 0)
+        {
+            fprintf(stderr,
+                    "Usage: mpirun -np N %s [-f format] <input_file> "
+                    "<output_file>\n",
+                    argv[0]);
+            fprintf(stderr, "format is text, binary or auto (default, "
+                            "binary for a .bin file), binary files are "
+                            "read and written by all the ranks\n");
+        }
+        MPI_Finalize();
+        exit(EXIT_FAILURE);
+    }
+    if (rank == 0 && access(args[0], F_OK) == -1)
+    {
+        fail(args[0], "does not exist");
+    }
+
+    int total, n;
+    int *T;
+    read_slice(args[0], &total, &n, &T);
+
+    if (rank == 0)
+    {
+        printf("\nNumber of processes: %d, threads per process: %d\n", p,
+               omp_get_max_threads());
+        printf("Number of values: %d\n", total);
+        fflush(stdout);
+    }
+
+    /**********************************************
+     * Sort
+     ***********************************************/
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    double times[NB_PHASES];
+    int part;
+    int *sorted = tri_mpi(T, n, &part, times);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double stop = MPI_Wtime();
+
+    double slowest[NB_PHASES];
+    int largest;
+    MPI_Reduce(times, slowest, NB_PHASES, MPI_DOUBLE, MPI_MAX, 0,
+               MPI_COMM_WORLD);
+    MPI_Reduce(&part, &largest, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+    int ok = is_sorted_global(sorted, part);
+
+    if (rank == 0)
+    {
+        for (int i = 0; i < NB_PHASES; i++)
+        {
+            printf("%-10s : %g s (slowest rank)\n", phase_names[i],
+                   slowest[i]);
+        }
+        printf("Largest part : %d values (%.2f x the average)\n", largest,
+               total > 0 ? (double)largest * p / total : 0);
+        printf("%s\n", ok ? "Sorted" : "wrong output");
+    }
+
+    /**********************************************
+     * Write output file
+     ***********************************************/
+    write_part(args[1], total, part, sorted);
+
+    if (rank == 0)
+    {
+        printf("\033[0;32m\nTime: %g s\n\033[0m", stop - start);
+    }
+
+    free(sorted);
+    MPI_Finalize();
+    exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
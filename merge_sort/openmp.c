@@ -5,7 +5,9 @@
  * This file contains the implementation of a merge sort algorithm using
  * OpenMP to parallelize the sorting. The program reads an array of integers
  * from a file, sorts the array using parallel merge sort, and then writes
- * the sorted array to another file.
+ * the sorted array to another file. The sorts are the OpenMP backend of
+ * libpsort (sort_openmp.c), the external sort of files larger than the
+ * memory lives here.
  *
  ******************************************************************************/
 
@@ -13,227 +15,399 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <limits.h>
 #include <omp.h>
+#include <string.h>
 #include <unistd.h>
+#include <getopt.h>
 
-#define INSERTION_SORT_THRESHOLD 10000
+#include "array_io.h"
+#include "loser_tree.h"
+#include "perf_counters.h"
+#include "psort.h"
 
 /**********************************************
- * @brief Prints an array of integers
- * @param tab The array to print
- * @param n The size of the array
+ * External sort : number of runs merged at once (as MULTIWAY_FAN_IN), and
+ * smallest read buffer of a run, in ints, below which the fan-in shrinks
  ***********************************************/
-void pretty_print_array(int *tab, int n)
+#define EXTERNAL_FAN_IN 64
+#define EXTERNAL_MIN_CHUNK 1024
+
+/**********************************************
+ * @brief A sorted run of a temporary file, read back through a buffer
+ * during a merge
+ * @arg offset Where the next values to read start in the file, in bytes
+ * @arg left The number of values of the run not read yet
+ * @arg buf The read buffer
+ * @arg len The number of values in buf
+ * @arg pos The next value of buf
+ ***********************************************/
+typedef struct Run
+{
+    off_t offset;
+    long left;
+    int *buf;
+    int len;
+    int pos;
+} run_t;
+
+/**********************************************
+ * @brief Opens an anonymous temporary file in $TMPDIR (or /tmp), removed
+ * when closed
+ * @return The file, open for writing then reading
+ ***********************************************/
+FILE *open_run_file(void)
 {
-    printf("[");
-    if (n <= 1000)
+    const char *dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/tri_externe_XXXXXX", dir);
+
+    int fd = mkstemp(path);
+    if (fd == -1)
     {
-        for (int i = 0; i < n; i++)
-        {
-            printf("%d", tab[i]);
-            if (i < n - 1)
-            {
-                printf(", ");
-            }
-        }
+        perror("Error mkstemp");
+        exit(EXIT_FAILURE);
     }
-    else
+    unlink(path);
+
+    FILE *f = fdopen(fd, "w+b");
+    if (f == NULL)
     {
-        for (int i = 0; i < 100; i++)
-        {
-            printf("%d", tab[i]);
-            if (i < 99)
-            {
-                printf(", ");
-            }
-        }
-        printf(", ... , ");
-        for (int i = n - 100; i < n; i++)
-        {
-            printf("%d", tab[i]);
-            if (i < n - 1)
-            {
-                printf(", ");
-            }
-        }
+        perror("Error fdopen");
+        exit(EXIT_FAILURE);
     }
-    printf("]\n");
+    return f;
 }
 
 /**********************************************
- * @brief Merges two sorted arrays into one sorted array
- * @param U The first sorted array
- * @param n The size of the first array
- * @param V The second sorted array
- * @param m The size of the second array
- * @param T The resulting merged array
+ * @brief Reads up to n ints at the given offset of a file
+ * @return The number of ints read, fewer than n at the end of the file
  ***********************************************/
-void fusion(int *U, int n, int *V, int m, int *T)
+long read_ints(int fd, int *T, long n, off_t offset)
 {
-    int i = 0, j = 0;
-    U[n] = INT_MAX;
-    V[m] = INT_MAX;
-    for (int k = 0; k < m + n; k++)
+    size_t want = n * sizeof(int);
+    size_t got = 0;
+    while (got < want)
     {
-        if (U[i] < V[j])
-        {
-            T[k] = U[i++];
-        }
-        else
+        ssize_t r = pread(fd, (char *)T + got, want - got, offset + got);
+        if (r == -1)
         {
-            T[k] = V[j++];
+            perror("Error pread");
+            exit(EXIT_FAILURE);
         }
+        if (r == 0)
+            break;
+        got += r;
     }
+    return got / sizeof(int);
+}
+
+/**********************************************
+ * @brief Refills the buffer of a run
+ * @param r The run
+ * @param f The file of the run, flushed
+ * @param chunk The size of its buffer
+ * @return 0 once the run is exhausted
+ ***********************************************/
+int run_refill(run_t *r, FILE *f, int chunk)
+{
+    r->len = read_ints(fileno(f), r->buf, r->left < chunk ? r->left : chunk,
+                       r->offset);
+    r->offset += r->len * sizeof(int);
+    r->left -= r->len;
+    r->pos = 0;
+    return r->len > 0;
 }
 
 /**********************************************
- * @brief Sorts an array of integers using insertion sort
- * @param tab The array to sort
- * @param n The size of the array
+ * @brief Merges sorted runs of a temporary file into another file
+ * @param runs The runs, their buffers allocated
+ * @param k The number of runs
+ * @param chunk The size of the read buffer of each run, in ints
+ * @param f The file of the runs, flushed
+ * @param f_out The output file
+ * @param text 1 to write the values in the text format of
+ * write_output_file, 0 as raw ints
  ***********************************************/
-void tri_insertion(int *tab, int n)
+void merge_runs(run_t *runs, int k, int chunk, FILE *f, FILE *f_out,
+                int text)
 {
-    for (int i = 1; i < n; i++)
+    loser_tree_t lt;
+    unsigned long long node[3 * loser_tree_leaves(k)];
+    loser_tree_init(&lt, k, node);
+
+    for (int r = 0; r < k; r++)
     {
-        int x = tab[i];
-        int j = i;
-        while (j > 0 && tab[j - 1] > x)
+        if (run_refill(&runs[r], f, chunk))
         {
-            tab[j] = tab[j - 1];
-            j--;
+            loser_tree_set(&lt, r, runs[r].buf[0]);
+        }
+    }
+    loser_tree_build(&lt);
+
+    while (!loser_tree_empty(&lt))
+    {
+        run_t *r = &runs[loser_tree_winner(&lt)];
+        int x = loser_tree_min(&lt);
+        if (text ? fprintf(f_out, "%d ", x) < 0
+                 : fwrite(&x, sizeof(int), 1, f_out) != 1)
+        {
+            perror("Error fwrite");
+            exit(EXIT_FAILURE);
+        }
+        if (++r->pos < r->len || run_refill(r, f, chunk))
+        {
+            loser_tree_replace(&lt, r->buf[r->pos]);
+        }
+        else
+        {
+            loser_tree_pop(&lt); // run exhausted
         }
-        tab[j] = x;
     }
 }
 
 /**********************************************
- * @brief Sorts an array of integers using parallel merge sort with OpenMP
- * @param tab The array to sort
- * @param n The size of the array
+ * @brief Sorts the input file into the output file without loading it
+ * whole in memory (external merge sort)
+ * @param input The input file, text or binary as for read_input_file
+ * @param output The output file, text or binary as for write_output_file
+ * @param mem_budget The memory the arrays may use, in bytes
+ * @param opts The options of the in-memory parallel sort of the runs
+ *
+ * The input is cut in runs of mem_budget / 8 values (the array and the
+ * scratch array of tri_fusion), parsed from a text file or read with pread
+ * after the header of a binary one. They are sorted and spilled one after
+ * the other to a temporary file, then merged EXTERNAL_FAN_IN at a time with
+ * a loser tree, into another temporary file, until the last pass writes
+ * the output (a binary one as a header and the packed ints) : two
+ * temporary files are open at a time, whatever the number of runs. The
+ * budget is shared by the read buffers of a merge and the buffer of its
+ * output, the fan-in shrinks when the buffers would be smaller than
+ * EXTERNAL_MIN_CHUNK. An input with fewer values than announced is an
+ * error, as for read_array.
+ *
+ * @code
+ * tant que l'entree n'est pas vide
+ *  lire jusqu'a B valeurs, les trier en parallele, les ajouter aux runs
+ * tant qu'il reste plus de K runs
+ *  fusionner les runs par groupes de K (arbre des perdants) : une passe
+ * fusionner les derniers runs dans la sortie
+ * @endcode
  ***********************************************/
-void tri_fusion(int *tab, int n)
+void tri_externe(char *input, char *output, long mem_budget,
+                 const psort_opts_t *opts)
 {
+    FILE *f = fopen(input, "r");
+    if (f == NULL)
+    {
+        perror("Error fopen");
+        exit(EXIT_FAILURE);
+    }
 
-    /**********************************************
-     * Base case + Threshold case
-     ***********************************************/
-    if (n < 2)
-        return;
-    else if (n <= INSERTION_SORT_THRESHOLD)
+    long long array_size;
+    off_t body = 0; // where the values of a binary input start
+    if (array_is_binary(input))
+    {
+        array_header_t header;
+        if (fread(&header, sizeof(header), 1, f) != 1 ||
+            memcmp(header.magic, ARRAY_MAGIC, 4) != 0 ||
+            header.type != ARRAY_INT32)
+        {
+            fprintf(stderr, "%s : not a binary array file of int\n", input);
+            exit(EXIT_FAILURE);
+        }
+        array_size = header.count;
+        body = sizeof(header);
+    }
+    else if (fscanf(f, "%lld", &array_size) != 1)
     {
-        tri_insertion(tab, n);
-        return;
+        fprintf(stderr, "%s : missing array size\n", input);
+        exit(EXIT_FAILURE);
     }
 
-    /**********************************************
-     * Starting recursion
-     ***********************************************/
+    long run_size = mem_budget / (2 * sizeof(int));
+    if (run_size > array_size)
+        run_size = array_size;
+    if (run_size < 1)
+        run_size = 1;
+    if (run_size > 0x7fffffff)
+        run_size = 0x7fffffff;
 
     /**********************************************
-     * Initialization of parallel splitting
+     * Sorted runs, spilled to a temporary file
      ***********************************************/
-    int mid = n / 2;
-    int *U = malloc((mid + 1) * sizeof(int));
-    int *V = malloc((n - mid + 1) * sizeof(int));
-
-    if (U == NULL || V == NULL)
+    int *T = malloc(run_size * sizeof(int));
+    if (T == NULL)
     {
-        perror("malloc : U or V error");
+        perror("malloc : run error");
         exit(EXIT_FAILURE);
     }
 
-// Every thread has access to this part of the code
-#pragma omp parallel sections
+    FILE *spill = open_run_file();
+    run_t *runs = NULL;
+    int k = 0;
+    long long count = 0;
+    while (count < array_size)
     {
-// Master gets one, slave gets the other
-#pragma omp section
-        for (int i = 0; i < mid; i++)
+        int len = 0;
+        if (body > 0)
         {
-            U[i] = tab[i];
+            len = read_ints(fileno(f), T,
+                            array_size - count < run_size ? array_size - count
+                                                          : run_size,
+                            body + count * sizeof(int));
+            count += len;
         }
-#pragma omp section
-        for (int i = 0; i < n - mid; i++)
+        while (body == 0 && len < run_size && count < array_size &&
+               fscanf(f, "%d", &T[len]) == 1)
         {
-            V[i] = tab[i + mid];
+            len++;
+            count++;
         }
-    }
-    /**********************************************
-     * Recursive sorting
-     ***********************************************/
+        if (len == 0)
+            break; // fewer values than announced, rejected below
 
-#pragma omp parallel
-    {
-#pragma omp single
+        if (psort_sort(T, len, PSORT_INT32, PSORT_OPENMP, opts) != 0)
         {
-// Master thread sorts U, slave V
-#pragma omp task
-            tri_fusion(U, mid);
-            tri_fusion(V, n - mid);
+            perror("psort_sort");
+            exit(EXIT_FAILURE);
         }
-    }
-    // implicit barrier
-    fusion(U, mid, V, n - mid, tab);
 
-    free(U);
-    free(V);
-}
-/**********************************************
- * @brief Read the given input file and store the values in the array T
- *
- * @param filename
- * @param array_size
- * @param T the array to store the values
- ***********************************************/
-void read_input_file(char *filename, int *array_size, int **T)
-{
-    FILE *f = fopen(filename, "r");
-    if (f == NULL)
+        runs = realloc(runs, (k + 1) * sizeof(run_t));
+        if (runs == NULL)
+        {
+            perror("realloc : runs error");
+            exit(EXIT_FAILURE);
+        }
+        runs[k].offset = ftello(spill);
+        runs[k].left = len;
+        if (fwrite(T, sizeof(int), len, spill) != (size_t)len)
+        {
+            perror("Error fwrite");
+            exit(EXIT_FAILURE);
+        }
+        k++;
+    }
+    free(T);
+    fclose(f);
+    if (count < array_size)
     {
-        perror("Error fopen");
+        // same error as read_array, the output is left untouched
+        fprintf(stderr, "%s : %lld values, %lld announced\n", input, count,
+                array_size);
+        fclose(spill); // unlinked when opened, closing removes it
+        free(runs);
         exit(EXIT_FAILURE);
     }
+    fflush(spill);
+    printf("%lld values, %d sorted runs of at most %ld values\n", count, k,
+           run_size);
+
+    /**********************************************
+     * Merges of at most fan_in runs, the budget shared by their read
+     * buffers and the buffer of their output
+     ***********************************************/
+    long budget_ints = mem_budget / sizeof(int);
+    long fan_in = budget_ints / EXTERNAL_MIN_CHUNK - 1;
+    if (fan_in > EXTERNAL_FAN_IN)
+        fan_in = EXTERNAL_FAN_IN;
+    if (fan_in > k)
+        fan_in = k;
+    if (fan_in < 2)
+        fan_in = 2;
+    long chunk = budget_ints / (fan_in + 1);
+    if (chunk > run_size)
+        chunk = run_size;
+    if (chunk < 1)
+        chunk = 1;
 
-    int c, count = 0;
-    fscanf(f, "%d", array_size);
-    *T = malloc(*array_size * sizeof(int));
-    if (*T == NULL)
+    int *buf = malloc(fan_in * chunk * sizeof(int));
+    if (buf == NULL)
     {
-        perror("malloc : T error for argc == 3");
+        perror("malloc : run buffer error");
         exit(EXIT_FAILURE);
     }
-
-    while (!feof(f))
+    for (int r = 0; r < k; r++)
     {
-        fscanf(f, "%d", &c);
-        (*T)[count] = c;
-        count++;
+        runs[r].buf = buf + (r % fan_in) * chunk;
     }
 
-    fclose(f);
-}
+    int passes = 0;
+    while (k > fan_in)
+    {
+        FILE *next = open_run_file();
+        setvbuf(next, NULL, _IOFBF, chunk * sizeof(int));
+        int nb_merged = 0;
+        for (int r = 0; r < k; r += fan_in)
+        {
+            int m = k - r < fan_in ? k - r : fan_in;
+            run_t merged = {.offset = ftello(next), .left = 0};
+            for (int i = r; i < r + m; i++)
+            {
+                merged.left += runs[i].left;
+            }
+            merge_runs(runs + r, m, chunk, spill, next, 0);
+            merged.buf = buf + (nb_merged % fan_in) * chunk;
+            runs[nb_merged++] = merged;
+        }
+        fflush(next);
+        fclose(spill);
+        spill = next;
+        k = nb_merged;
+        passes++;
+    }
 
-/**********************************************
- * @brief Write the sorted array to the given output file
- *
- * @param filename
- * @param array_size
- * @param T, the sorted array
- ***********************************************/
-void write_output_file(char *filename, int array_size, int *T)
-{
-    FILE *f_out = fopen(filename, "w");
+    int binary_out = array_is_binary(output);
+    FILE *f_out = fopen(output, "wb");
     if (f_out == NULL)
     {
         perror("Error fopen");
         exit(EXIT_FAILURE);
     }
-    for (int i = 0; i < array_size; i++)
+    setvbuf(f_out, NULL, _IOFBF, chunk * sizeof(int));
+    if (binary_out)
     {
-        fprintf(f_out, "%d ", T[i]);
+        array_header_t header = {.type = ARRAY_INT32, .count = count};
+        memcpy(header.magic, ARRAY_MAGIC, 4);
+        if (fwrite(&header, sizeof(header), 1, f_out) != 1)
+        {
+            perror("Error fwrite");
+            exit(EXIT_FAILURE);
+        }
     }
 
+    merge_runs(runs, k, chunk, spill, f_out, !binary_out);
+    printf("%d merge passes of at most %ld runs, %ld ints per buffer\n",
+           passes + 1, fan_in, chunk);
+
     fclose(f_out);
+    fclose(spill);
+    free(buf);
+    free(runs);
+}
+
+/**********************************************
+ * @brief Parses a size in bytes, with an optional K, M or G suffix
+ * @param str The size
+ * @return The size, or 0 if str is not a valid size
+ ***********************************************/
+long parse_size(const char *str)
+{
+    char *unit;
+    long size = strtol(str, &unit, 10);
+    switch (*unit)
+    {
+    case 'G':
+        size *= 1024;
+        // fall through
+    case 'M':
+        size *= 1024;
+        // fall through
+    case 'K':
+        size *= 1024;
+        unit++;
+        break;
+    }
+    return *unit == '\0' && size > 0 ? size : 0;
 }
 
 /**
@@ -248,24 +422,136 @@ int main(int argc, char *argv[])
      * Initialization
      ***********************************************/
 
-    // argc = 2 : ./d2p <size_of_array>
-    // argc = 3 : ./d2p <input_file> <output_file>
-    if (argc != 2 && argc != 3)
+    // ./d2p [-m mode] <size_of_array>
+    // ./d2p [-m mode] [-f format] [-b mem_budget] <input_file> <output_file>
+    // ./d2p -T type [-f format] <input_file> <output_file>
+    // ./d2p -a [-p] [-T type] [-f format] <input_file> <permutation_file>
+    psort_opts_t opts = {.algorithm = PSORT_FUSION};
+    long mem_budget = 0; // external sort if set
+    int type = ARRAY_INT32;
+    int argsort_only = 0; // writes the sorting permutation if set
+    int permute = 0;      // with -a, writes the values reordered by it
+    struct option options[] = {{"mode", required_argument, NULL, 'm'},
+                               {"mem-budget", required_argument, NULL, 'b'},
+                               {"format", required_argument, NULL, 'f'},
+                               {"type", required_argument, NULL, 'T'},
+                               {"argsort", no_argument, NULL, 'a'},
+                               {"permute", no_argument, NULL, 'p'},
+                               {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "m:b:f:T:ap", options, NULL)) != -1)
     {
-        fprintf(stderr, "Usage: %s <size_of_array>\n", argv[0]);
+        if (opt == 'm' && strcmp(optarg, "fusion") == 0)
+        {
+            opts.algorithm = PSORT_FUSION;
+        }
+        else if (opt == 'm' && strcmp(optarg, "sample") == 0)
+        {
+            opts.algorithm = PSORT_SAMPLE;
+        }
+        else if (opt == 'm' && strcmp(optarg, "multiway") == 0)
+        {
+            opts.algorithm = PSORT_MULTIWAY;
+        }
+        else if (opt == 'm' && strcmp(optarg, "adaptive") == 0)
+        {
+            opts.algorithm = PSORT_ADAPTIVE;
+        }
+        else if (opt == 'm' && strcmp(optarg, "numa") == 0)
+        {
+            opts.algorithm = PSORT_NUMA;
+        }
+        else if (opt == 'm' && strcmp(optarg, "inplace") == 0)
+        {
+            opts.algorithm = PSORT_INPLACE;
+        }
+        else if (opt == 'm' && strcmp(optarg, "radix") == 0)
+        {
+            opts.algorithm = PSORT_RADIX;
+        }
+        else if (opt == 'b' && (mem_budget = parse_size(optarg)) > 0)
+        {
+            // tri_externe
+        }
+        else if (opt == 'f' &&
+                 (array_format = parse_array_format(optarg)) >= 0)
+        {
+            // read_array and write_array
+        }
+        else if (opt == 'T' && (type = parse_array_type(optarg)) > 0)
+        {
+            // typed sorts for the other types than int
+        }
+        else if (opt == 'a')
+        {
+            argsort_only = 1;
+        }
+        else if (opt == 'p')
+        {
+            permute = 1;
+        }
+        else
+        {
+            argc = 0; // prints the usage below
+            break;
+        }
+    }
+    int nb_args = argc - optind;
+    char **args = argv + optind;
+
+    if (((nb_args != 1 || mem_budget > 0) && nb_args != 2) ||
+        ((type != ARRAY_INT32 || argsort_only) &&
+         (opts.algorithm != PSORT_FUSION || mem_budget > 0)) ||
+        (permute && !argsort_only))
+    {
+        fprintf(stderr, "Usage: %s [-m mode] <size_of_array>\n", argv[0]);
         fprintf(stderr, "OR\n");
-        fprintf(stderr, "Usage: %s <input_file> <output_file>\n", argv[0]);
+        fprintf(stderr,
+                "Usage: %s [-m mode] [-f format] [-b mem_budget] "
+                "<input_file> <output_file>\n",
+                argv[0]);
+        fprintf(stderr, "mode is fusion (merge sort, default), sample "
+                        "(sample sort), multiway (multiway merge sort), "
+                        "adaptive (merge of the natural runs), numa "
+                        "(pinned threads, node-local memory), inplace "
+                        "(no scratch array) or radix (LSD radix sort)\n");
+        fprintf(stderr, "format is text, binary or auto (default, binary for "
+                        "a .bin file)\n");
+        fprintf(stderr, "mem_budget (bytes, or with a K, M or G suffix) "
+                        "sorts a file without loading it whole\n");
+        fprintf(stderr, "-T/--type int (default), int64, uint32, float, "
+                        "double or kv (key:value), fusion mode only\n");
+        fprintf(stderr, "-a/--argsort writes the stable sorting permutation "
+                        "(uint32 indices) instead of the sorted array\n");
+        fprintf(stderr, "-p/--permute with -a, writes the values reordered "
+                        "by the permutation instead\n");
         exit(EXIT_FAILURE);
     }
 
-    int *T;
+    if (mem_budget > 0)
+    {
+        // ./d2p -b mem_budget <input_file> <output_file>
+        if (access(args[0], F_OK) == -1)
+        {
+            fprintf(stderr, "The given input file does not exist\n");
+            exit(EXIT_FAILURE);
+        }
+        printf("\nNumber of threads: %d\n", omp_get_max_threads());
+        double start = omp_get_wtime();
+        tri_externe(args[0], args[1], mem_budget, &opts);
+        double stop = omp_get_wtime();
+        printf("\033[0;32m\nTime: %g s\n\033[0m", stop - start);
+        exit(EXIT_SUCCESS);
+    }
+
+    void *T;
     int array_size;
 
-    if (argc == 2)
+    if (nb_args == 1)
     {
         // ./d2p <size_of_array>
-        array_size = atoi(argv[1]);
-        T = malloc(array_size * sizeof(int));
+        array_size = atoi(args[0]);
+        T = malloc(array_size * array_type_size(type));
         if (T == NULL)
         {
             perror("malloc : T error, for argc == 2");
@@ -273,47 +559,106 @@ int main(int argc, char *argv[])
         }
         // we will sort the memory allocated
     }
-    else // argc == 3
+    else // nb_args == 2
     {
         // ./d2p <input_file> <output_file>
-        if (access(argv[1], F_OK) == -1 || access(argv[2], F_OK) == -1)
+        if (access(args[0], F_OK) == -1 || access(args[1], F_OK) == -1)
         {
             fprintf(stderr, "One of the given file does not exist\n");
             exit(EXIT_FAILURE);
         }
-        read_input_file(argv[1], &array_size, &T);
+        perf_team_begin();
+        read_array(args[0], argsort_only ? NULL : args[1], type, &array_size,
+                   &T);
+        perf_team_end(PERF_READ, array_file_size(args[0]),
+                      (size_t)array_size * array_type_size(type));
     }
 
     // Run with max threads
-    omp_set_num_threads(omp_get_max_threads());
     printf("\nNumber of threads: %d\n", omp_get_max_threads());
 
     /**********************************************
      * Sort
      ***********************************************/
-    printf("Before sorting:\n");
-    pretty_print_array(T, array_size);
-    fflush(stdout);
+    if (type == ARRAY_INT32)
+    {
+        printf("Before sorting:\n");
+        pretty_print_array(T, array_size);
+        fflush(stdout);
+    }
 
+    uint32_t *perm = NULL;
     double start = omp_get_wtime();
-    tri_fusion(T, array_size);
+    if (argsort_only)
+    {
+        perm = malloc(array_size * sizeof(uint32_t));
+        if (perm == NULL)
+        {
+            perror("malloc : perm error");
+            exit(EXIT_FAILURE);
+        }
+        if (psort_argsort(T, array_size, type, PSORT_OPENMP, perm, &opts) != 0)
+        {
+            perror("psort_argsort");
+            exit(EXIT_FAILURE);
+        }
+    }
+    else
+    {
+        if (psort_sort(T, array_size, type, PSORT_OPENMP, &opts) != 0)
+        {
+            perror("psort_sort");
+            exit(EXIT_FAILURE);
+        }
+    }
     double stop = omp_get_wtime();
 
     /**********************************************
      * Print after sorting
      ***********************************************/
-    printf("After sorting:\n");
-    pretty_print_array(T, array_size);
+    if (type == ARRAY_INT32 && !argsort_only)
+    {
+        printf("After sorting:\n");
+        pretty_print_array(T, array_size);
+    }
     printf("\033[0;32m\nTime: %g s\n\033[0m", stop - start);
     fflush(stdout);
 
-    if (argc == 3)
+    if (nb_args == 2)
     {
         /**********************************************
          * Writing the sorted array to a file
          ***********************************************/
-        write_output_file(argv[2], array_size, T);
+        perf_team_begin();
+        if (argsort_only && permute)
+        {
+            void *sorted = malloc(array_size * array_type_size(type));
+            if (sorted == NULL)
+            {
+                perror("malloc : sorted error");
+                exit(EXIT_FAILURE);
+            }
+            psort_apply_permutation(T, sorted, array_size, type, perm);
+            write_array(args[1], type, array_size, sorted);
+            free(sorted);
+        }
+        else if (argsort_only)
+        {
+            write_array(args[1], ARRAY_UINT32, array_size, perm);
+        }
+        else
+        {
+            write_array(args[1], type, array_size, T);
+        }
+        perf_team_end(PERF_WRITE,
+                      (size_t)array_size *
+                          array_type_size(argsort_only && !permute
+                                              ? ARRAY_UINT32
+                                              : type),
+                      array_file_size(args[1]));
     }
-    free(T);
+    perf_report(stdout);
+    free(perm);
+    free_array(T);
     exit(EXIT_SUCCESS);
 }
\ No newline at end of file
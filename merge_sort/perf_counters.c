@@ -0,0 +1,290 @@
+/*******************************************************************************
+ * @file perf_counters.c
+ * @brief Optional hardware counters of the sort phases
+ *
+ * Every thread opens its own group of four counters (pid 0, any cpu, user
+ * space only) the first time it reads them, and adds its deltas to its own
+ * row of slots : no atomics on the way. Without perf_event_open (container,
+ * perf_event_paranoid), the times and bytes are still reported.
+ ******************************************************************************/
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <omp.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perf_counters.h"
+
+/**********************************************
+ * @brief What the threads did in a phase
+ * @arg value The events
+ * @arg time The time spent, summed over the calls
+ * @arg bytes_read, bytes_written The data consumed and produced
+ * @arg calls The number of calls
+ ***********************************************/
+typedef struct Perf_slot
+{
+    uint64_t value[PERF_NB_EVENTS];
+    double time;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t calls;
+} perf_slot_t;
+
+int perf_enabled = 0;
+
+static perf_slot_t (*slots)[PERF_NB_PHASES]; // [thread][phase]
+static atomic_int nb_threads;
+static atomic_int open_error; // errno of the first perf_event_open failure
+
+static _Thread_local int thread_slot = -1;
+static _Thread_local int group_fd = -2; // -2 : not opened, -1 : unavailable
+
+static perf_sample_t team_start[PERF_MAX_THREADS];
+
+static const char *const phase_names[PERF_MERGE] = {"read", "copy", "leaf",
+                                                    "write"};
+
+static const struct
+{
+    uint32_t type;
+    uint64_t config;
+} events[PERF_NB_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+/**********************************************
+ * @brief Opens the counters of the calling thread as one group
+ * @return The fd of the group leader, -1 if perf_event_open failed
+ ***********************************************/
+static int open_group(void)
+{
+    int leader = -1;
+    for (int e = 0; e < PERF_NB_EVENTS; e++)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[e].type;
+        attr.config = events[e].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP |
+                           PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fd == -1)
+        {
+            // the threads of a team fail together, the first one wins
+            int none = 0;
+            atomic_compare_exchange_strong(&open_error, &none, errno);
+            if (leader != -1)
+            {
+                close(leader); // closes the group
+            }
+            return -1;
+        }
+        if (leader == -1)
+        {
+            leader = fd;
+        }
+    }
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return leader;
+}
+
+void perf_read(perf_sample_t *s)
+{
+    s->time = omp_get_wtime();
+    if (group_fd == -2)
+    {
+        group_fd = open_group();
+    }
+
+    struct
+    {
+        uint64_t nr;
+        uint64_t enabled;
+        uint64_t running;
+        uint64_t value[PERF_NB_EVENTS];
+    } data;
+    if (group_fd < 0 || read(group_fd, &data, sizeof(data)) != sizeof(data))
+    {
+        memset(s->value, 0, sizeof(s->value));
+        return;
+    }
+
+    // multiplexed counters only ran part of the time
+    double scale = data.running > 0 ? (double)data.enabled / data.running : 0;
+    for (int e = 0; e < PERF_NB_EVENTS; e++)
+    {
+        s->value[e] = data.value[e] * scale;
+    }
+}
+
+void perf_add(const perf_sample_t *start, int phase, size_t bytes_read,
+              size_t bytes_written)
+{
+    if (thread_slot == -1)
+    {
+        thread_slot = atomic_fetch_add(&nb_threads, 1);
+    }
+    if (thread_slot >= PERF_MAX_THREADS)
+        return;
+
+    perf_sample_t stop;
+    perf_read(&stop);
+
+    perf_slot_t *slot = &slots[thread_slot][phase];
+    for (int e = 0; e < PERF_NB_EVENTS; e++)
+    {
+        slot->value[e] += stop.value[e] - start->value[e];
+    }
+    slot->time += stop.time - start->time;
+    slot->bytes_read += bytes_read;
+    slot->bytes_written += bytes_written;
+    slot->calls++;
+}
+
+void perf_team_begin(void)
+{
+    if (!perf_enabled)
+        return;
+
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        if (t < PERF_MAX_THREADS)
+        {
+            perf_read(&team_start[t]);
+        }
+    }
+}
+
+void perf_team_end(int phase, size_t bytes_read, size_t bytes_written)
+{
+    if (!perf_enabled)
+        return;
+
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        if (t < PERF_MAX_THREADS)
+        {
+            perf_add(&team_start[t], phase, t == 0 ? bytes_read : 0,
+                     t == 0 ? bytes_written : 0);
+        }
+    }
+}
+
+/**********************************************
+ * @brief Prints one line of the report
+ ***********************************************/
+static void print_slot(FILE *out, const char *name, const perf_slot_t *s)
+{
+    double ipc = s->value[0] > 0 ? (double)s->value[1] / s->value[0] : 0;
+    fprintf(out,
+            "%-10s %8llu %10.4f %14llu %14llu %5.2f %12llu %12llu %10.1f "
+            "%10.1f\n",
+            name, (unsigned long long)s->calls, s->time,
+            (unsigned long long)s->value[0], (unsigned long long)s->value[1],
+            ipc, (unsigned long long)s->value[2],
+            (unsigned long long)s->value[3], s->bytes_read / 1e6,
+            s->bytes_written / 1e6);
+}
+
+/**********************************************
+ * @brief Adds a slot to another one
+ ***********************************************/
+static void add_slot(perf_slot_t *sum, const perf_slot_t *s)
+{
+    for (int e = 0; e < PERF_NB_EVENTS; e++)
+    {
+        sum->value[e] += s->value[e];
+    }
+    sum->time += s->time;
+    sum->bytes_read += s->bytes_read;
+    sum->bytes_written += s->bytes_written;
+    sum->calls += s->calls;
+}
+
+void perf_report(FILE *out)
+{
+    if (!perf_enabled)
+        return;
+
+    int threads = atomic_load(&nb_threads);
+    if (threads > PERF_MAX_THREADS)
+        threads = PERF_MAX_THREADS;
+
+    fprintf(out, "\nHardware counters (time : summed over the threads)");
+    int error = atomic_load(&open_error);
+    if (error != 0)
+    {
+        fprintf(out, ", unavailable : %s", strerror(error));
+    }
+    fprintf(out, "\n%-10s %8s %10s %14s %14s %5s %12s %12s %10s %10s\n",
+            "phase", "calls", "time_s", "cycles", "instructions", "IPC",
+            "llc_misses", "br_misses", "MB_read", "MB_written");
+
+    for (int phase = 0; phase < PERF_NB_PHASES; phase++)
+    {
+        perf_slot_t sum = {0};
+        for (int t = 0; t < threads; t++)
+        {
+            add_slot(&sum, &slots[t][phase]);
+        }
+        if (sum.calls == 0)
+            continue;
+
+        char name[16];
+        if (phase < PERF_MERGE)
+        {
+            snprintf(name, sizeof(name), "%s", phase_names[phase]);
+        }
+        else
+        {
+            snprintf(name, sizeof(name), "merge d%d", phase - PERF_MERGE);
+        }
+        print_slot(out, name, &sum);
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        perf_slot_t sum = {0};
+        for (int phase = 0; phase < PERF_NB_PHASES; phase++)
+        {
+            add_slot(&sum, &slots[t][phase]);
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "thread %d", t);
+        print_slot(out, name, &sum);
+    }
+}
+
+/**********************************************
+ * @brief Reads PSORT_PERF and allocates the slots
+ ***********************************************/
+__attribute__((constructor)) static void perf_counters_init(void)
+{
+    char *env = getenv("PSORT_PERF");
+    if (env == NULL || strcmp(env, "0") == 0)
+        return;
+
+    slots = calloc(PERF_MAX_THREADS, sizeof(*slots));
+    if (slots == NULL)
+    {
+        perror("calloc : perf slots error");
+        return;
+    }
+    perf_enabled = 1;
+}
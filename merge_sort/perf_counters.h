@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * @file perf_counters.h
+ * @brief Optional hardware counters of the sort phases (perf_event_open),
+ * enabled by the PSORT_PERF environment variable
+ *
+ * Each phase adds the cycles, instructions, last level cache misses and
+ * branch misses of the calling thread, its duration and the bytes it read
+ * and wrote, to a slot per thread and per phase. The merges have one phase
+ * per recursion depth. Disabled, a phase costs a test of perf_enabled.
+ ******************************************************************************/
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**********************************************
+ * Phases : the merges at depth d are phase PERF_MERGE + d (the deepest
+ * ones share the last phase)
+ ***********************************************/
+#define PERF_READ 0
+#define PERF_COPY 1
+#define PERF_LEAF 2
+#define PERF_WRITE 3
+#define PERF_MERGE 4
+#define PERF_MAX_DEPTH 32
+#define PERF_NB_PHASES (PERF_MERGE + PERF_MAX_DEPTH)
+
+/**********************************************
+ * Counted events, and most threads reported (the others are not counted)
+ ***********************************************/
+#define PERF_NB_EVENTS 4 // cycles, instructions, LLC misses, branch misses
+#define PERF_MAX_THREADS 256
+
+/**********************************************
+ * @brief The counters of a thread at some point
+ * @arg value The events, scaled if the kernel multiplexed them
+ * @arg time omp_get_wtime()
+ ***********************************************/
+typedef struct Perf_sample
+{
+    uint64_t value[PERF_NB_EVENTS];
+    double time;
+} perf_sample_t;
+
+/**********************************************
+ * @brief 1 if PSORT_PERF is set (and not "0") at startup
+ ***********************************************/
+extern int perf_enabled;
+
+/**********************************************
+ * @brief Reads the counters of the calling thread, opened by its first
+ * call
+ ***********************************************/
+void perf_read(perf_sample_t *s);
+
+/**********************************************
+ * @brief Adds what the calling thread did since start to a phase
+ * @param bytes_read, bytes_written The data the phase consumed and
+ * produced (not the DRAM traffic, that llc_misses * 64 estimates)
+ ***********************************************/
+void perf_add(const perf_sample_t *start, int phase, size_t bytes_read,
+              size_t bytes_written);
+
+/**********************************************
+ * @brief Starts a phase run by all the OpenMP threads (I/O) : each thread
+ * of the next parallel regions reads its counters
+ ***********************************************/
+void perf_team_begin(void);
+
+/**********************************************
+ * @brief Ends the phase of perf_team_begin(), the bytes are counted for
+ * the calling thread
+ ***********************************************/
+void perf_team_end(int phase, size_t bytes_read, size_t bytes_written);
+
+/**********************************************
+ * @brief Prints the counters by phase and by thread
+ ***********************************************/
+void perf_report(FILE *out);
+
+/**********************************************
+ * Hooks of the sorts, a test only when disabled
+ ***********************************************/
+static inline void perf_begin(perf_sample_t *s)
+{
+    if (perf_enabled)
+        perf_read(s);
+}
+
+static inline void perf_end(const perf_sample_t *s, int phase,
+                            size_t bytes_read, size_t bytes_written)
+{
+    if (perf_enabled)
+        perf_add(s, phase, bytes_read, bytes_written);
+}
+
+/**********************************************
+ * @brief Phase of the merges at a depth of the recursion
+ ***********************************************/
+static inline int perf_merge_phase(int depth)
+{
+    return PERF_MERGE +
+           (depth < PERF_MAX_DEPTH - 1 ? depth : PERF_MAX_DEPTH - 1);
+}
+
+#endif
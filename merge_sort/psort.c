@@ -0,0 +1,285 @@
+/*******************************************************************************
+ * @file psort.c
+ * @brief libpsort : dispatch of psort_sort() to the backends
+ ******************************************************************************/
+#include <errno.h>
+#include <omp.h>
+
+#include "fusion.h"
+#include "leaf_sort.h"
+#include "psort.h"
+#include "selection.h"
+#include "sort_backends.h"
+#include "typed_sort.h"
+
+/**********************************************
+ * Size in bytes of a value of each type, PSORT_INT32 to PSORT_KV
+ ***********************************************/
+static const size_t type_size[] = {0,        sizeof(int),   sizeof(int64_t),
+                                   sizeof(uint32_t), sizeof(float),
+                                   sizeof(double),   sizeof(kv_t)};
+
+/**********************************************
+ * @brief The tunables of the process, saved during a call
+ ***********************************************/
+typedef struct Tunables
+{
+    int leaf_size;
+    int parallel_merge_cutoff;
+    int task_cutoff;
+} tunables_t;
+
+/**********************************************
+ * @brief Applies the tunables set in opts, for one call
+ * @return The tunables before, for restore_tunables()
+ ***********************************************/
+static tunables_t set_tunables(const psort_opts_t *opts)
+{
+    tunables_t saved = {leaf_size, parallel_merge_cutoff, task_cutoff};
+    if (opts->leaf_size > 0)
+    {
+        leaf_size = opts->leaf_size;
+    }
+    if (opts->parallel_merge_cutoff > 0)
+    {
+        parallel_merge_cutoff = opts->parallel_merge_cutoff;
+    }
+    if (opts->task_cutoff > 0)
+    {
+        task_cutoff = opts->task_cutoff;
+    }
+    return saved;
+}
+
+/**********************************************
+ * @brief Return value of an entry point from the one of a sort : the
+ * arguments are checked before, so a sort only fails when memory runs out
+ * @return 0, or -1 with errno ENOMEM
+ ***********************************************/
+static int out_of_memory(int status)
+{
+    if (status != 0)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************
+ * @brief Puts back the tunables of the process at the end of a call
+ ***********************************************/
+static void restore_tunables(tunables_t saved)
+{
+    leaf_size = saved.leaf_size;
+    parallel_merge_cutoff = saved.parallel_merge_cutoff;
+    task_cutoff = saved.task_cutoff;
+}
+
+int psort_sort(void *data, size_t n, int type, int backend,
+               const psort_opts_t *opts)
+{
+    psort_opts_t o = opts != NULL ? *opts : (psort_opts_t){0};
+
+    if (n > INT32_MAX || type < PSORT_INT32 || type > PSORT_KV ||
+        backend < PSORT_SEQUENTIAL || backend > PSORT_OPENMP ||
+        (backend == PSORT_PTHREAD && type != PSORT_INT32) ||
+        (o.algorithm != PSORT_FUSION &&
+         (backend != PSORT_OPENMP || type != PSORT_INT32 ||
+          (unsigned)o.algorithm > PSORT_RADIX)))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    tunables_t tunables = set_tunables(&o);
+
+    int status;
+    if (backend == PSORT_SEQUENTIAL)
+    {
+        status = type == PSORT_INT32 ? tri_fusion_sequential(data, n)
+                                     : typed_sort_seq(data, n, type);
+    }
+    else if (backend == PSORT_PTHREAD)
+    {
+        status = tri_fusion_pth(data, n, o.num_threads);
+    }
+    else // PSORT_OPENMP
+    {
+        // the number of threads is an ICV of the calling thread only
+        int saved = omp_get_max_threads();
+        if (o.num_threads > 0)
+        {
+            omp_set_num_threads(o.num_threads);
+        }
+
+        if (type != PSORT_INT32)
+        {
+            status = typed_sort_omp(data, n, type, task_cutoff);
+        }
+        else if (o.algorithm == PSORT_SAMPLE)
+        {
+            status = tri_echantillon(data, n);
+        }
+        else if (o.algorithm == PSORT_MULTIWAY)
+        {
+            status = tri_multiway(data, n);
+        }
+        else if (o.algorithm == PSORT_ADAPTIVE)
+        {
+            status = tri_adaptive(data, n);
+        }
+        else if (o.algorithm == PSORT_NUMA)
+        {
+            status = tri_numa(data, n);
+        }
+        else if (o.algorithm == PSORT_INPLACE)
+        {
+            status = tri_inplace(data, n);
+        }
+        else if (o.algorithm == PSORT_RADIX)
+        {
+            status = tri_radix(data, n);
+        }
+        else
+        {
+            status = tri_fusion_omp(data, n);
+        }
+
+        omp_set_num_threads(saved);
+    }
+    restore_tunables(tunables);
+    return out_of_memory(status);
+}
+
+int psort_argsort(const void *keys, size_t n, int type, int backend,
+                  uint32_t *perm, const psort_opts_t *opts)
+{
+    psort_opts_t o = opts != NULL ? *opts : (psort_opts_t){0};
+
+    if (n > INT32_MAX || type < PSORT_INT32 || type > PSORT_DOUBLE ||
+        (backend != PSORT_SEQUENTIAL && backend != PSORT_OPENMP))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    tunables_t tunables = set_tunables(&o);
+
+    if (backend == PSORT_SEQUENTIAL)
+    {
+        int status = argsort(keys, n, type, perm, 0);
+        restore_tunables(tunables);
+        return out_of_memory(status);
+    }
+
+    int saved = omp_get_max_threads();
+    if (o.num_threads > 0)
+    {
+        omp_set_num_threads(o.num_threads);
+    }
+    int status = argsort(keys, n, type, perm, task_cutoff);
+    omp_set_num_threads(saved);
+    restore_tunables(tunables);
+    return out_of_memory(status);
+}
+
+int psort_apply_permutation(const void *src, void *dst, int n, int type,
+                            const uint32_t *perm)
+{
+    if (n < 0 || type < PSORT_INT32 || type > PSORT_KV)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    apply_permutation(src, dst, n, type_size[type], perm);
+    return 0;
+}
+
+/**********************************************
+ * @brief Runs one of the selections with the options and backend given
+ * @param what 0 : nth_element, 1 : partial_sort, 2 : top_k
+ ***********************************************/
+static int run_selection(int what, void *data, size_t n, size_t k, void *out,
+                         int type, int backend, const psort_opts_t *opts)
+{
+    psort_opts_t o = opts != NULL ? *opts : (psort_opts_t){0};
+
+    if (n > INT32_MAX || k > n || (what == 0 && k == n) ||
+        type < PSORT_INT32 || type > PSORT_KV ||
+        (backend != PSORT_SEQUENTIAL && backend != PSORT_OPENMP))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    tunables_t tunables = set_tunables(&o);
+
+    int parallel = backend == PSORT_OPENMP;
+    int saved = omp_get_max_threads();
+    if (parallel && o.num_threads > 0)
+    {
+        omp_set_num_threads(o.num_threads);
+    }
+
+    int status;
+    if (what == 0)
+    {
+        status = nth_element(data, n, k, type, parallel);
+    }
+    else if (what == 1)
+    {
+        status = partial_sort(data, n, k, type, parallel);
+    }
+    else
+    {
+        status = top_k(data, n, k, type, out, parallel);
+    }
+
+    omp_set_num_threads(saved);
+    restore_tunables(tunables);
+    return out_of_memory(status);
+}
+
+int psort_nth_element(void *data, size_t n, size_t k, int type, int backend,
+                      const psort_opts_t *opts)
+{
+    return run_selection(0, data, n, k, NULL, type, backend, opts);
+}
+
+int psort_partial_sort(void *data, size_t n, size_t k, int type,
+                       int backend, const psort_opts_t *opts)
+{
+    return run_selection(1, data, n, k, NULL, type, backend, opts);
+}
+
+int psort_top_k(const void *data, size_t n, size_t k, void *out, int type,
+                int backend, const psort_opts_t *opts)
+{
+    return run_selection(2, (void *)data, n, k, out, type, backend, opts);
+}
+
+int psort_is_sorted(const void *data, size_t n, int type)
+{
+    if (n > INT32_MAX || type < PSORT_INT32 || type > PSORT_KV)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (type != PSORT_INT32)
+    {
+        return typed_is_sorted(data, n, type);
+    }
+
+    const int *tab = data;
+    for (size_t i = 1; i < n; i++)
+    {
+        if (tab[i] < tab[i - 1])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void psort_shutdown(void)
+{
+    sort_pthread_shutdown();
+}
@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * @file psort.h
+ * @brief libpsort : the sorts of this directory as a library, to sort
+ * arrays in memory without a process and text files per sort
+ *
+ * Link with libpsort.a (or -lpsort), -fopenmp and -lpthread.
+ *
+ * The library never exits the process : a call returns -1 and sets errno,
+ * EINVAL for an unsupported combination of arguments, ENOMEM when the
+ * scratch memory (or a thread of the pthread pool) cannot be had.
+ ******************************************************************************/
+#ifndef PSORT_H
+#define PSORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************
+ * Types of the values, the same codes as the ARRAY_* types of array_io.h
+ ***********************************************/
+#define PSORT_INT32 1
+#define PSORT_INT64 2
+#define PSORT_UINT32 3
+#define PSORT_FLOAT 4
+#define PSORT_DOUBLE 5
+#define PSORT_KV 6 // struct {int64_t key; int64_t value;}, sorted by key
+
+/**********************************************
+ * Backends
+ ***********************************************/
+#define PSORT_SEQUENTIAL 0
+#define PSORT_PTHREAD 1
+#define PSORT_OPENMP 2
+
+/**********************************************
+ * Algorithms of the OpenMP backend for PSORT_INT32
+ ***********************************************/
+#define PSORT_FUSION 0   // merge sort
+#define PSORT_SAMPLE 1   // sample sort
+#define PSORT_MULTIWAY 2 // multiway merge sort
+#define PSORT_ADAPTIVE 3 // merge sort of the runs present in the input
+#define PSORT_NUMA 4     // merge sort on pinned threads and node-local memory
+#define PSORT_INPLACE 5  // merge sort in O(p sqrt(n)) extra memory
+#define PSORT_RADIX 6    // LSD radix sort
+
+/**********************************************
+ * @brief Options of a sort, 0 keeps the default of a field
+ * @arg num_threads The number of threads (OpenMP : for this sort, pthread :
+ * size of the pool when the first sort creates it)
+ * @arg algorithm PSORT_FUSION, PSORT_SAMPLE, PSORT_MULTIWAY,
+ * PSORT_ADAPTIVE, PSORT_NUMA (which moves the pages of data to the nodes
+ * of the threads sorting them), PSORT_INPLACE (no scratch array, slower)
+ * or PSORT_RADIX (not a comparison sort)
+ * @arg leaf_size, parallel_merge_cutoff, task_cutoff The tunables of
+ * leaf_sort.h, fusion.h and the OpenMP backend
+ *
+ * The tunables are global to the process : a call sets the ones given for
+ * its duration and puts the previous ones back. Sorts running at the same
+ * time must not give different ones.
+ ***********************************************/
+typedef struct Psort_opts
+{
+    int num_threads;
+    int algorithm;
+    int leaf_size;
+    int parallel_merge_cutoff;
+    int task_cutoff;
+} psort_opts_t;
+
+/**********************************************
+ * @brief Sorts an array in place
+ * @param data The array
+ * @param n The number of values, at most INT32_MAX
+ * @param type PSORT_INT32 to PSORT_KV
+ * @param backend PSORT_SEQUENTIAL, PSORT_PTHREAD or PSORT_OPENMP
+ * @param opts The options, NULL for the defaults
+ * @return 0, or -1 if the combination is not supported (EINVAL) : the
+ * pthread backend and the algorithms other than PSORT_FUSION only sort
+ * PSORT_INT32. -1 with ENOMEM if memory runs out, data unchanged.
+ *
+ * Floats and doubles are sorted in the IEEE 754 total order, records
+ * stably by key.
+ ***********************************************/
+int psort_sort(void *data, size_t n, int type, int backend,
+               const psort_opts_t *opts);
+
+/**********************************************
+ * @brief Stable argsort, see argsort() in typed_sort.h
+ * @param perm The permutation, n indices
+ * @return 0, or -1 if the combination is not supported (pthread backend)
+ * or memory runs out
+ ***********************************************/
+int psort_argsort(const void *keys, size_t n, int type, int backend,
+                  uint32_t *perm, const psort_opts_t *opts);
+
+/**********************************************
+ * @brief Reorders an array by a permutation, dst[i] = src[perm[i]], with
+ * all the threads, see apply_permutation() in typed_sort.h
+ * @param src The array, n values of the given type
+ * @param dst The reordered array, must not overlap src
+ * @param type PSORT_INT32 to PSORT_KV
+ * @param perm The permutation, as given by psort_argsort()
+ * @return 0, or -1 with EINVAL if type is unknown or n negative
+ ***********************************************/
+int psort_apply_permutation(const void *src, void *dst, int n, int type,
+                            const uint32_t *perm);
+
+/**********************************************
+ * @brief Puts in data[k] the value psort_sort() would put there, the
+ * values before it not greater and the ones after it not smaller
+ * @param k The rank, k < n
+ * @param backend PSORT_SEQUENTIAL or PSORT_OPENMP (parallel partitions)
+ * @return 0, or -1 if the combination is not supported (pthread backend)
+ * or memory runs out, data then holding its values in another order
+ ***********************************************/
+int psort_nth_element(void *data, size_t n, size_t k, int type, int backend,
+                      const psort_opts_t *opts);
+
+/**********************************************
+ * @brief Sorts the k smallest values into data[0..k-1], the others after
+ * them in any order, in O(n + k log k)
+ * @param k The number of values sorted, k <= n
+ * @return 0, or -1 if the combination is not supported (pthread backend)
+ * or memory runs out, data then holding its values in another order
+ ***********************************************/
+int psort_partial_sort(void *data, size_t n, size_t k, int type,
+                       int backend, const psort_opts_t *opts);
+
+/**********************************************
+ * @brief Copies the k smallest values of data, sorted, to out, data
+ * unchanged
+ * @param k The number of values, k <= n
+ * @param out The result, k values, must not overlap data
+ * @return 0, or -1 if the combination is not supported (pthread backend)
+ * or memory runs out
+ *
+ * One heap per thread, then a selection among the heaps : for k much
+ * smaller than n, one pass over data.
+ ***********************************************/
+int psort_top_k(const void *data, size_t n, size_t k, void *out, int type,
+                int backend, const psort_opts_t *opts);
+
+/**********************************************
+ * @brief 1 if data is sorted in the order of psort_sort(), 0 if not, -1
+ * if type is unknown or n too large
+ ***********************************************/
+int psort_is_sorted(const void *data, size_t n, int type);
+
+/**********************************************
+ * @brief Path of the config file of the tunables : $PSORT_CONFIG if set,
+ * $HOME/.psort.conf otherwise, NULL if neither is set
+ *
+ * The library reads it at startup, before the LEAF_SIZE, TASK_CUTOFF and
+ * PARALLEL_MERGE_CUTOFF environment variables, which take precedence.
+ ***********************************************/
+const char *psort_config_path(void);
+
+/**********************************************
+ * @brief Reads "name = value" lines (leaf_size, task_cutoff,
+ * parallel_merge_cutoff, # for comments) and sets the tunables
+ * @param path The file, NULL for psort_config_path()
+ * @return 0, or -1 if the file cannot be opened. Unknown names and
+ * invalid values are reported on stderr and skipped.
+ ***********************************************/
+int psort_load_config(const char *path);
+
+/**********************************************
+ * @brief Writes the tunables of opts in the format of psort_load_config()
+ * @param path The file, NULL for psort_config_path()
+ * @param opts The tunables, 0 writes the current value of a field
+ * @return 0, or -1 on error (errno is set)
+ ***********************************************/
+int psort_save_config(const char *path, const psort_opts_t *opts);
+
+/**********************************************
+ * @brief Stops the threads kept by the pthread backend between sorts
+ ***********************************************/
+void psort_shutdown(void);
+
+#endif
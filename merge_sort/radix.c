@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * @file radix.c
+ * @brief Parallel LSD radix sort of 32-bit integers using OpenMP
+ *
+ * Same command line and output as openmp.c, the sort itself is the
+ * PSORT_RADIX algorithm of libpsort (sort_radix.c), which bench also runs.
+ ******************************************************************************/
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "array_io.h"
+#include "psort.h"
+
+/**
+ * @brief Entry point of the program
+ * @param argc The number of command-line arguments
+ * @param argv The command-line arguments
+ * @return The exit code of the program
+ */
+int main(int argc, char *argv[])
+{
+    /**********************************************
+     * Initialization
+     ***********************************************/
+
+    // ./radix <size_of_array>
+    // ./radix [-f format] <input_file> <output_file>
+    struct option options[] = {{"format", required_argument, NULL, 'f'},
+                               {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:", options, NULL)) != -1)
+    {
+        if (opt != 'f' || (array_format = parse_array_format(optarg)) < 0)
+        {
+            argc = 0; // prints the usage below
+            break;
+        }
+    }
+    int nb_args = argc - optind;
+    char **args = argv + optind;
+
+    if (nb_args != 1 && nb_args != 2)
+    {
+        fprintf(stderr, "Usage: %s <size_of_array>\n", argv[0]);
+        fprintf(stderr, "OR\n");
+        fprintf(stderr, "Usage: %s [-f format] <input_file> <output_file>\n",
+                argv[0]);
+        fprintf(stderr, "format is text, binary or auto (default, binary for "
+                        "a .bin file)\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int *T;
+    int array_size;
+
+    if (nb_args == 1)
+    {
+        // ./radix <size_of_array>
+        array_size = atoi(args[0]);
+        T = malloc(array_size * sizeof(int));
+        if (T == NULL)
+        {
+            perror("malloc : T error, for argc == 2");
+            exit(EXIT_FAILURE);
+        }
+        // we will sort the memory allocated
+    }
+    else // nb_args == 2
+    {
+        // ./radix <input_file> <output_file>
+        if (access(args[0], F_OK) == -1 || access(args[1], F_OK) == -1)
+        {
+            fprintf(stderr, "One of the given file does not exist\n");
+            exit(EXIT_FAILURE);
+        }
+        read_input_file(args[0], args[1], &array_size, &T);
+    }
+
+    // Run with max threads
+    omp_set_num_threads(omp_get_max_threads());
+    printf("\nNumber of threads: %d\n", omp_get_max_threads());
+
+    /**********************************************
+     * Sort
+     ***********************************************/
+    printf("Before sorting:\n");
+    pretty_print_array(T, array_size);
+    fflush(stdout);
+
+    psort_opts_t opts = {.algorithm = PSORT_RADIX};
+    double start = omp_get_wtime();
+    if (psort_sort(T, array_size, PSORT_INT32, PSORT_OPENMP, &opts) != 0)
+    {
+        perror("psort_sort");
+        exit(EXIT_FAILURE);
+    }
+    double stop = omp_get_wtime();
+
+    /**********************************************
+     * Print after sorting
+     ***********************************************/
+    printf("After sorting:\n");
+    pretty_print_array(T, array_size);
+    printf("\033[0;32m\nTime: %g s\n\033[0m", stop - start);
+    fflush(stdout);
+
+    if (nb_args == 2)
+    {
+        /**********************************************
+         * Writing the sorted array to a file
+         ***********************************************/
+        write_output_file(args[1], array_size, T);
+    }
+    free_array(T);
+    exit(EXIT_SUCCESS);
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * @file selection.c
+ * @brief Instances of selection_impl.h for every element type, and the
+ * dispatch on the type code
+ ******************************************************************************/
+#include <errno.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array_io.h"
+#include "fusion.h"
+#include "selection.h"
+#include "sort_backends.h"
+#include "typed_sort.h"
+
+/**********************************************
+ * @brief Sorts tab with the merge sort of its type, sequential or OpenMP
+ * @return 0, or -1 if the scratch array cannot be allocated
+ ***********************************************/
+static int sort_values(void *tab, int n, int type, int parallel)
+{
+    if (type != ARRAY_INT32)
+    {
+        return typed_sort_omp(tab, n, type, parallel ? task_cutoff : 0);
+    }
+    return parallel ? tri_fusion_omp(tab, n) : tri_fusion_sequential(tab, n);
+}
+
+/**********************************************
+ * @brief Hash of i (splitmix64 finalizer), for the sample positions
+ ***********************************************/
+static inline uint64_t mix(uint64_t i)
+{
+    i = (i ^ (i >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    i = (i ^ (i >> 27)) * 0x94d049bb133111ebULL;
+    return i ^ (i >> 31);
+}
+
+#define TYPE int
+#define SUFFIX i32
+#define LESS(a, b) ((a) < (b))
+#define TYPE_CODE ARRAY_INT32
+#include "selection_impl.h"
+
+#define TYPE int64_t
+#define SUFFIX i64
+#define LESS(a, b) ((a) < (b))
+#define TYPE_CODE ARRAY_INT64
+#include "selection_impl.h"
+
+#define TYPE uint32_t
+#define SUFFIX u32
+#define LESS(a, b) ((a) < (b))
+#define TYPE_CODE ARRAY_UINT32
+#include "selection_impl.h"
+
+#define TYPE float
+#define SUFFIX f32
+#define LESS(a, b) (key_f32(a) < key_f32(b))
+#define TYPE_CODE ARRAY_FLOAT
+#include "selection_impl.h"
+
+#define TYPE double
+#define SUFFIX f64
+#define LESS(a, b) (key_f64(a) < key_f64(b))
+#define TYPE_CODE ARRAY_DOUBLE
+#include "selection_impl.h"
+
+#define TYPE kv_t
+#define SUFFIX kv
+#define LESS(a, b) ((a).key < (b).key)
+#define TYPE_CODE ARRAY_KV
+#include "selection_impl.h"
+
+int nth_element(void *tab, int n, int k, int type, int parallel)
+{
+    switch (type)
+    {
+    case ARRAY_INT32:
+        return select_i32(tab, n, k, parallel);
+    case ARRAY_INT64:
+        return select_i64(tab, n, k, parallel);
+    case ARRAY_UINT32:
+        return select_u32(tab, n, k, parallel);
+    case ARRAY_FLOAT:
+        return select_f32(tab, n, k, parallel);
+    case ARRAY_DOUBLE:
+        return select_f64(tab, n, k, parallel);
+    case ARRAY_KV:
+        return select_kv(tab, n, k, parallel);
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+int partial_sort(void *tab, int n, int k, int type, int parallel)
+{
+    if (k <= 0)
+        return 0;
+
+    if (k < n && nth_element(tab, n, k - 1, type, parallel) != 0)
+        return -1;
+    return sort_values(tab, k < n ? k : n, type, parallel);
+}
+
+int top_k(const void *tab, int n, int k, int type, void *out, int parallel)
+{
+    switch (type)
+    {
+    case ARRAY_INT32:
+        return top_k_i32(tab, n, k, out, parallel);
+    case ARRAY_INT64:
+        return top_k_i64(tab, n, k, out, parallel);
+    case ARRAY_UINT32:
+        return top_k_u32(tab, n, k, out, parallel);
+    case ARRAY_FLOAT:
+        return top_k_f32(tab, n, k, out, parallel);
+    case ARRAY_DOUBLE:
+        return top_k_f64(tab, n, k, out, parallel);
+    case ARRAY_KV:
+        return top_k_kv(tab, n, k, out, parallel);
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * @file selection.h
+ * @brief Selections of every element type : nth_element, partial sort and
+ * top-k, in the order of the sorts (typed_sort.h)
+ *
+ * The kernels are generated for every type from selection_impl.h. The
+ * types are the ARRAY_* codes of array_io.h.
+ ******************************************************************************/
+#ifndef SELECTION_H
+#define SELECTION_H
+
+/**********************************************
+ * Sample of the pivots of the parallel nth_element, and the margin around
+ * rank k taken between them : about 2 SELECT_MARGIN / SELECT_SAMPLE of the
+ * values are kept at each round
+ ***********************************************/
+#define SELECT_SAMPLE 4096
+#define SELECT_MARGIN 128
+
+/**********************************************
+ * @brief Puts in tab[k] the value of rank k, the values before it not
+ * greater and the ones after it not smaller
+ * @param tab The array, of n values of the given type
+ * @param n The size of the array
+ * @param k The rank, k < n
+ * @param type ARRAY_INT32 to ARRAY_KV
+ * @param parallel 1 to use all the OpenMP threads
+ * @return 0, or -1 if the scratch memory cannot be allocated (tab then
+ * holds the same values, maybe reordered) or type is unknown
+ *
+ * Rounds of partitions (parallel if asked) around two pivots sampled near
+ * rank k, until the range holding rank k is below parallel_merge_cutoff
+ * values, then quickselect : O(n) work and n values of scratch memory.
+ ***********************************************/
+int nth_element(void *tab, int n, int k, int type, int parallel);
+
+/**********************************************
+ * @brief Sorts the k smallest values of tab into tab[0..k-1], the others
+ * after them in any order
+ *
+ * nth_element(), then a sort of the first k values : O(n + k log k).
+ ***********************************************/
+int partial_sort(void *tab, int n, int k, int type, int parallel);
+
+/**********************************************
+ * @brief Copies the k smallest values of tab, sorted, to out, tab unchanged
+ * @param out The result, k values, must not overlap tab
+ *
+ * Each thread keeps the k smallest values of its slice in a heap (one
+ * comparison per value once full), then the k smallest of the heaps are
+ * selected and sorted : O(n + p k log k) for values in random order.
+ ***********************************************/
+int top_k(const void *tab, int n, int k, int type, void *out, int parallel);
+
+#endif
@@ -0,0 +1,351 @@
+/*******************************************************************************
+ * @file selection_impl.h
+ * @brief Template of the selections, included once per type by selection.c
+ *
+ * Before including it, define :
+ *  TYPE        the element type
+ *  SUFFIX      the suffix of the generated functions
+ *  LESS(a, b)  1 if a sorts strictly before b
+ *  TYPE_CODE   the ARRAY_* code of TYPE, for sort_values()
+ ******************************************************************************/
+
+#define CAT_(a, b) a##_##b
+#define CAT(a, b) CAT_(a, b)
+#define F(name) CAT(name, SUFFIX)
+
+static inline void F(swap)(TYPE *a, TYPE *b)
+{
+    TYPE tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/**********************************************
+ * @brief Median of three values
+ ***********************************************/
+static inline TYPE F(median3)(TYPE a, TYPE b, TYPE c)
+{
+    if (LESS(b, a))
+        F(swap)(&a, &b);
+    if (LESS(c, b))
+        b = LESS(c, a) ? a : c;
+    return b;
+}
+
+/**********************************************
+ * @brief Sequential nth_element : quickselect, median of three pivots and
+ * three-way partitions (equal keys end the search), sorting the range
+ * left after 2 log2(n) rounds
+ * @return 0, or -1 if that sort cannot allocate its scratch array
+ ***********************************************/
+static int F(select_seq)(TYPE *tab, int n, int k)
+{
+    int rounds = 2 * (32 - __builtin_clz(n | 1));
+    while (n > 1)
+    {
+        if (rounds-- == 0)
+        {
+            return sort_values(tab, n, TYPE_CODE, 0);
+        }
+
+        TYPE pivot = F(median3)(tab[0], tab[n / 2], tab[n - 1]);
+        int lt = 0, i = 0, gt = n; // [< pivot][= pivot][unknown][> pivot]
+        while (i < gt)
+        {
+            if (LESS(tab[i], pivot))
+            {
+                F(swap)(&tab[lt++], &tab[i++]);
+            }
+            else if (LESS(pivot, tab[i]))
+            {
+                F(swap)(&tab[i], &tab[--gt]);
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        if (k < lt)
+        {
+            n = lt;
+        }
+        else if (k >= gt)
+        {
+            tab += gt;
+            k -= gt;
+            n -= gt;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/**********************************************
+ * @brief Two pivots around the value of rank k of tab, from a sorted
+ * pseudo-random sample : about n / 16 values lie between them, the value
+ * of rank k almost always among them
+ * @return 0, or -1 if the sample cannot be sorted
+ ***********************************************/
+static int F(pivots)(const TYPE *tab, int n, int k, TYPE *lo, TYPE *hi)
+{
+    TYPE sample[SELECT_SAMPLE];
+    for (int i = 0; i < SELECT_SAMPLE; i++)
+    {
+        sample[i] = tab[mix((uint64_t)n * SELECT_SAMPLE + i) % n];
+    }
+    if (sort_values(sample, SELECT_SAMPLE, TYPE_CODE, 0) != 0)
+        return -1;
+
+    long r = (long)k * SELECT_SAMPLE / n;
+    *lo = sample[r > SELECT_MARGIN ? r - SELECT_MARGIN : 0];
+    *hi = sample[r + SELECT_MARGIN < SELECT_SAMPLE ? r + SELECT_MARGIN
+                                                     : SELECT_SAMPLE - 1];
+    return 0;
+}
+
+/**********************************************
+ * @brief Partitions tab into [< lo][lo..hi][> hi]
+ * @param buf A scratch array of n values
+ * @param parallel 1 to use all the threads
+ * @param n_lt, n_le Receive the size of the first part, and of the first
+ * two
+ *
+ * Each thread counts the three parts in its slice, then copies its values
+ * to their place in buf (prefix sums of the counts), and buf is copied
+ * back : stable, two reads and two writes of the array.
+ ***********************************************/
+static void F(partition)(TYPE *tab, TYPE *buf, int n, TYPE lo, TYPE hi,
+                         int *n_lt, int *n_le, int parallel)
+{
+    int p = parallel ? omp_get_max_threads() : 1;
+    int count[p][3];
+
+#pragma omp parallel num_threads(p) if (parallel)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int a = (long)n * t / nt;
+        int b = (long)n * (t + 1) / nt;
+
+        int lt = 0, gt = 0;
+        for (int i = a; i < b; i++)
+        {
+            lt += LESS(tab[i], lo);
+            gt += LESS(hi, tab[i]);
+        }
+        count[t][0] = lt;
+        count[t][1] = b - a - lt - gt;
+        count[t][2] = gt;
+#pragma omp barrier
+
+        int total[3] = {0, 0, 0};
+        int before[3] = {0, 0, 0};
+        for (int u = 0; u < nt; u++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                total[c] += count[u][c];
+                before[c] += u < t ? count[u][c] : 0;
+            }
+        }
+        int pos[3] = {before[0], total[0] + before[1],
+                      total[0] + total[1] + before[2]};
+        for (int i = a; i < b; i++)
+        {
+            int c = LESS(tab[i], lo) ? 0 : LESS(hi, tab[i]) ? 2 : 1;
+            buf[pos[c]++] = tab[i];
+        }
+#pragma omp barrier
+        memcpy(tab + a, buf + a, (b - a) * sizeof(TYPE));
+
+        if (t == 0)
+        {
+            *n_lt = total[0];
+            *n_le = total[0] + total[1];
+        }
+    }
+}
+
+/**********************************************
+ * @brief nth_element : puts in tab[k] the value of rank k, the values
+ * before it not greater, the ones after it not smaller
+ * @param parallel 1 to partition with all the threads
+ * @return 0, or -1 if the scratch array cannot be allocated (tab then
+ * holds the same values, maybe reordered)
+ *
+ * The partitions around sampled pivots read the array about twice in
+ * all, the sequential quickselect is left for the last
+ * parallel_merge_cutoff values.
+ *
+ * @code
+ * tant que le tableau est grand
+ *  choisir deux pivots autour du rang k (echantillon)
+ *  partitionner (en parallele) : [< lo][lo..hi][> hi]
+ *  continuer dans la partie qui contient le rang k
+ * quickselect sequentiel
+ * @endcode
+ ***********************************************/
+static int F(select)(TYPE *tab, int n, int k, int parallel)
+{
+    TYPE *buf = NULL;
+    while (n >= parallel_merge_cutoff)
+    {
+        TYPE lo, hi;
+        if ((buf == NULL && (buf = malloc(n * sizeof(TYPE))) == NULL) ||
+            F(pivots)(tab, n, k, &lo, &hi) != 0)
+        {
+            free(buf);
+            return -1;
+        }
+        int n_lt, n_le;
+        F(partition)(tab, buf, n, lo, hi, &n_lt, &n_le, parallel);
+
+        if (k < n_lt)
+        {
+            n = n_lt;
+        }
+        else if (k >= n_le)
+        {
+            tab += n_le;
+            k -= n_le;
+            n -= n_le;
+        }
+        else if (!LESS(lo, hi)) // the middle part holds equal values
+        {
+            n = 0;
+        }
+        else if (n_lt == 0 && n_le == n) // no progress : too few keys
+        {
+            break;
+        }
+        else
+        {
+            tab += n_lt;
+            k -= n_lt;
+            n = n_le - n_lt;
+        }
+    }
+    free(buf);
+
+    return n > 1 ? F(select_seq)(tab, n, k) : 0;
+}
+
+/**********************************************
+ * @brief Restores the max-heap heap[0..n-1] from its root down
+ ***********************************************/
+static void F(sift_down)(TYPE *heap, int n, int i)
+{
+    TYPE x = heap[i];
+    for (int child; (child = 2 * i + 1) < n; i = child)
+    {
+        if (child + 1 < n && LESS(heap[child], heap[child + 1]))
+        {
+            child++;
+        }
+        if (!LESS(x, heap[child]))
+            break;
+        heap[i] = heap[child];
+    }
+    heap[i] = x;
+}
+
+/**********************************************
+ * @brief Keeps the k smallest values of tab[0..n-1] in a max-heap
+ * @param heap Receives them, min(k, n) values
+ * @return min(k, n)
+ *
+ * Once the heap is full, a value costs one comparison with its root
+ * unless it is smaller : about k ln(n / k) replacements of log2(k) swaps
+ * for values in random order.
+ ***********************************************/
+static int F(heap_k)(const TYPE *tab, int n, int k, TYPE *heap)
+{
+    int size = k < n ? k : n;
+    memcpy(heap, tab, size * sizeof(TYPE));
+    for (int i = size / 2 - 1; i >= 0; i--)
+    {
+        F(sift_down)(heap, size, i);
+    }
+    for (int i = size; i < n; i++)
+    {
+        if (LESS(tab[i], heap[0]))
+        {
+            heap[0] = tab[i];
+            F(sift_down)(heap, size, 0);
+        }
+    }
+    return size;
+}
+
+/**********************************************
+ * @brief Copies the k smallest values of tab, sorted, to out
+ * @param parallel 1 to give every thread its own heap
+ * @return 0, or -1 if the heaps cannot be allocated
+ *
+ * Each thread keeps the k smallest values of its slice in a heap, then the
+ * k smallest of the heaps are selected and sorted. When the heaps would
+ * hold as many values as tab, tab is copied and selected instead.
+ ***********************************************/
+static int F(top_k)(const TYPE *tab, int n, int k, TYPE *out, int parallel)
+{
+    if (k > n)
+        k = n;
+    if (k == 0)
+        return 0;
+
+    int p = parallel ? omp_get_max_threads() : 1;
+    int nb = (long)k * p < n ? k * p : n;
+    TYPE *cand = malloc(nb * sizeof(TYPE));
+    if (cand == NULL)
+        return -1;
+
+    if (nb == n)
+    {
+        memcpy(cand, tab, n * sizeof(TYPE));
+    }
+    else
+    {
+        int size[p];
+        int nt = 1;
+#pragma omp parallel num_threads(p) if (parallel)
+        {
+            int t = omp_get_thread_num();
+            int nb_threads = omp_get_num_threads();
+            if (t == 0)
+            {
+                nt = nb_threads;
+            }
+            int a = (long)n * t / nb_threads;
+            int b = (long)n * (t + 1) / nb_threads;
+            size[t] = F(heap_k)(tab + a, b - a, k, cand + (long)t * k);
+        }
+
+        nb = 0; // the heaps, packed
+        for (int t = 0; t < nt; t++)
+        {
+            memmove(cand + nb, cand + (long)t * k, size[t] * sizeof(TYPE));
+            nb += size[t];
+        }
+    }
+
+    int status = k < nb ? F(select)(cand, nb, k - 1, parallel) : 0;
+    if (status == 0)
+    {
+        status = sort_values(cand, k, TYPE_CODE, parallel);
+    }
+    memcpy(out, cand, k * sizeof(TYPE));
+    free(cand);
+    return status;
+}
+
+#undef F
+#undef CAT
+#undef CAT_
+#undef TYPE
+#undef SUFFIX
+#undef LESS
+#undef TYPE_CODE
@@ -0,0 +1,492 @@
+/*******************************************************************************
+ * @file sort_adaptive.c
+ * @brief OpenMP backend of libpsort : adaptive merge sort of ints, which
+ * merges the runs already present in the input (natural merge sort)
+ ******************************************************************************/
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fusion.h"
+#include "leaf_sort.h"
+#include "sort_backends.h"
+
+/**********************************************
+ * Number of times in a row one side of a merge must win before the merge
+ * gallops through it (min_gallop of TimSort)
+ ***********************************************/
+#define MIN_GALLOP 7
+
+/**********************************************
+ * Values merged by fusion() between two gallop attempts, doubled after
+ * each failed attempt up to GALLOP_CHUNK_MAX
+ ***********************************************/
+#define GALLOP_CHUNK 32
+#define GALLOP_CHUNK_MAX 4096
+
+/**********************************************
+ * @brief The runs of the array, in order
+ * @arg start The start of each run, start[count] = n
+ * @arg power The powersort power of the boundary between runs r - 1 and
+ * r, in power[r] : the smaller, the closer to the root of the merge tree
+ * @arg count The number of runs
+ ***********************************************/
+typedef struct Runs
+{
+    int *start;
+    int *power;
+    int count;
+} runs_t;
+
+/**********************************************
+ * @brief Reverses tab[0..n-1]
+ ***********************************************/
+static void reverse(int *tab, int n)
+{
+    for (int i = 0, j = n - 1; i < j; i++, j--)
+    {
+        int tmp = tab[i];
+        tab[i] = tab[j];
+        tab[j] = tmp;
+    }
+}
+
+/**********************************************
+ * @brief Number of values of tab[0..n-1] smaller than x (or not greater
+ * than x if or_equal), by exponential then binary search from the left
+ ***********************************************/
+static int gallop(int x, const int *tab, int n, int or_equal)
+{
+    int hi = 1;
+    while (hi <= n && (or_equal ? tab[hi - 1] <= x : tab[hi - 1] < x))
+    {
+        hi *= 2;
+    }
+    int lo = hi / 2;
+    if (hi > n)
+        hi = n;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (or_equal ? tab[mid] <= x : tab[mid] < x)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**********************************************
+ * @brief Length of the natural run starting at tab[0], reversed in place if
+ * it is strictly descending
+ ***********************************************/
+static int natural_run(int *tab, int n)
+{
+    if (n < 2)
+        return n;
+
+    int len = 2;
+    if (tab[1] < tab[0])
+    {
+        while (len < n && tab[len] < tab[len - 1])
+        {
+            len++;
+        }
+        reverse(tab, len);
+    }
+    else
+    {
+        while (len < n && tab[len] >= tab[len - 1])
+        {
+            len++;
+        }
+    }
+    return len;
+}
+
+/**********************************************
+ * @brief Minimum run length of TimSort for n values : between 32 and 64,
+ * n / min_run(n) being a power of 2 or just below one
+ ***********************************************/
+static int min_run(int n)
+{
+    int r = 0;
+    while (n >= 64)
+    {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+/**********************************************
+ * @brief Sorted run starting at tab[0] : the natural run, extended to
+ * minrun values by binary insertion if it is shorter
+ * @param tab The array, the run sorted in place
+ * @param n The number of values from tab[0]
+ * @param minrun The length to extend the natural run to
+ * @return The length of the run, 0 if the values are too disordered to be
+ * worth the insertions
+ *
+ * A few values out of place cost a few moves each, random values about
+ * minrun / 4 each : past minrun^2 / 8 moves the values are left to the
+ * merge sort.
+ ***********************************************/
+static int extend_run(int *tab, int n, int minrun)
+{
+    int len = natural_run(tab, n);
+    int want = n < minrun ? n : minrun;
+    long moves = 0;
+    for (; len < want; len++)
+    {
+        int x = tab[len];
+        int pos = gallop(x, tab, len, 1);
+        memmove(tab + pos + 1, tab + pos, (len - pos) * sizeof(int));
+        tab[pos] = x;
+        moves += len - pos;
+    }
+    if (moves > (long)want * want / 8)
+        return 0;
+
+    while (len < n && tab[len] >= tab[len - 1])
+    {
+        len++;
+    }
+    return len;
+}
+
+/**********************************************
+ * @brief Cuts tab[lo..hi-1] into sorted runs
+ * @param tab The array, its runs sorted in place
+ * @param buf A scratch array for tri_fusion_seq()
+ * @param minrun The minimum run length
+ * @param start Receives the start of each run
+ * @return The number of runs, all of minrun values or more but the last
+ *
+ * Natural runs are kept (descending ones reversed) and the short ones
+ * extended by insertion, as in TimSort. Where the values are too
+ * disordered for that, runs are only looked for every leaf_size values
+ * until the next one : the blocks skipped are sorted as a single run by
+ * the tri_fusion_omp kernel, in cache order, so a random slice costs what
+ * it costs to tri_fusion_omp.
+ ***********************************************/
+static int find_runs(int *tab, int *buf, int lo, int hi, int minrun,
+                     int *start)
+{
+    int block = leaf_size > minrun ? leaf_size : minrun;
+    int count = 0;
+    int i = lo;
+    while (i < hi)
+    {
+        // a disordered block is skipped : random values are not scanned
+        int j = i;
+        int len = 0;
+        while (j < hi && (len = extend_run(tab + j, hi - j, minrun)) == 0)
+        {
+            j += hi - j < block ? hi - j : block;
+        }
+
+        if (j > i)
+        {
+            start[count++] = i;
+            memcpy(buf + i, tab + i, (j - i) * sizeof(int));
+            tri_fusion_seq(buf + i, tab + i, j - i);
+        }
+        if (len > 0)
+        {
+            start[count++] = j;
+        }
+        i = j + len;
+    }
+    return count;
+}
+
+/**********************************************
+ * @brief Powersort power of the boundary between two adjacent runs
+ * @param s1, n1 The start and length of the first run
+ * @param s2, n2 The start and length of the second run
+ * @param n The size of the array
+ *
+ * The first bit where the midpoints of the runs, as fractions of n,
+ * differ : the depth of the boundary in a merge tree balanced by size.
+ ***********************************************/
+static int node_power(long s1, long n1, long s2, long n2, long n)
+{
+    uint64_t a = ((uint64_t)(2 * s1 + n1) << 31) / n;
+    uint64_t b = ((uint64_t)(2 * s2 + n2) << 31) / n;
+    return __builtin_clzll(a ^ b);
+}
+
+/**********************************************
+ * @brief Detects the runs of tab with all the threads
+ * @param tab The array, its runs sorted in place
+ * @param buf A scratch array of n ints
+ * @param n The size of the array
+ * @param runs Receives the runs, to free by the caller
+ * @return 0, or -1 if the runs cannot be allocated (tab unchanged)
+ *
+ * Each thread cuts its own slice of the array, then adjacent runs already
+ * in order (a sorted input cut at the slice boundaries) are joined.
+ ***********************************************/
+static int detect_runs(int *tab, int *buf, int n, runs_t *runs)
+{
+    int p = omp_get_max_threads();
+    int minrun = min_run(n);
+    // a slice [lo, hi) has at most one run per minrun values, + 1
+    long capacity = n / minrun + p + 1;
+    int *start = malloc(capacity * sizeof(int));
+    int *first = malloc(p * sizeof(int));
+    int *count = malloc(p * sizeof(int));
+    runs->power = malloc(capacity * sizeof(int));
+    if (start == NULL || first == NULL || count == NULL ||
+        runs->power == NULL)
+    {
+        free(start);
+        free(first);
+        free(count);
+        free(runs->power);
+        return -1;
+    }
+
+    int nb_slices = 1;
+#pragma omp parallel num_threads(p)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int lo = (long)n * t / nt;
+        int hi = (long)n * (t + 1) / nt;
+        first[t] = lo / minrun + t;
+        count[t] = find_runs(tab, buf, lo, hi, minrun, start + first[t]);
+        if (t == 0)
+        {
+            nb_slices = nt;
+        }
+    }
+
+    /**********************************************
+     * Compaction, joining the runs in order
+     ***********************************************/
+    int nb_runs = 0;
+    for (int t = 0; t < nb_slices; t++)
+    {
+        for (int r = 0; r < count[t]; r++)
+        {
+            int s = start[first[t] + r];
+            if (nb_runs == 0 || tab[s - 1] > tab[s])
+            {
+                start[nb_runs++] = s;
+            }
+        }
+    }
+    start[nb_runs] = n;
+
+    for (int r = 1; r < nb_runs; r++)
+    {
+        runs->power[r] =
+            node_power(start[r - 1], start[r] - start[r - 1], start[r],
+                       start[r + 1] - start[r], n);
+    }
+    runs->start = start;
+    runs->count = nb_runs;
+    free(first);
+    free(count);
+    return 0;
+}
+
+/**********************************************
+ * @brief Merges two sorted arrays, galloping once one of them wins
+ * MIN_GALLOP times in a row
+ *
+ * Same contract as fusion(). Before each chunk, the merge checks whether
+ * the next MIN_GALLOP values of one array all come before the head of the
+ * other : the whole stretch is then found by galloping and copied.
+ * Otherwise a chunk is merged by fusion(), the chunk doubling while the
+ * checks fail, so interleaved values merge at the speed of the kernel.
+ ***********************************************/
+static void merge_gallop(const int *U, int n, const int *V, int m, int *T)
+{
+    int i = 0, j = 0;
+    int chunk = GALLOP_CHUNK;
+    while (i < n && j < m)
+    {
+        if (n - i >= MIN_GALLOP && U[i + MIN_GALLOP - 1] <= V[j])
+        {
+            int len = MIN_GALLOP + gallop(V[j], U + i + MIN_GALLOP,
+                                          n - i - MIN_GALLOP, 1);
+            memcpy(T + i + j, U + i, len * sizeof(int));
+            i += len;
+            chunk = GALLOP_CHUNK;
+        }
+        else if (m - j >= MIN_GALLOP && V[j + MIN_GALLOP - 1] < U[i])
+        {
+            int len = MIN_GALLOP + gallop(U[i], V + j + MIN_GALLOP,
+                                          m - j - MIN_GALLOP, 0);
+            memcpy(T + i + j, V + j, len * sizeof(int));
+            j += len;
+            chunk = GALLOP_CHUNK;
+        }
+        else
+        {
+            // the first k merged values are among the first k of U and V
+            int a = n - i < chunk ? n - i : chunk;
+            int b = m - j < chunk ? m - j : chunk;
+            int k = a + b < chunk ? a + b : chunk;
+            int c = co_rank(k, U + i, a, V + j, b);
+            fusion(U + i, c, V + j, k - c, T + i + j);
+            i += c;
+            j += k - c;
+            if (chunk < GALLOP_CHUNK_MAX)
+            {
+                chunk *= 2;
+            }
+        }
+    }
+    memcpy(T + i + j, U + i, (n - i) * sizeof(int));
+    memcpy(T + i + j, V + j, (m - j) * sizeof(int));
+}
+
+/**********************************************
+ * @brief Merges two sorted arrays, skipping the ends already in place
+ *
+ * Same contract as fusion(). The values of U not greater than V[0] and
+ * the values of V not smaller than U[n-1] are found by galloping and
+ * copied whole, the overlap of U and V is merged by merge_gallop() (by
+ * all the threads if parallel and large enough). Two runs barely
+ * overlapping, as in nearly sorted input, merge at the cost of a copy.
+ ***********************************************/
+static void fusion_gallop(const int *U, int n, const int *V, int m, int *T,
+                          int parallel)
+{
+    int head = gallop(V[0], U, n, 1);
+    int tail = m - gallop(U[n - 1], V, m, 0);
+
+    memcpy(T, U, head * sizeof(int));
+    memcpy(T + n + m - tail, V + m - tail, tail * sizeof(int));
+
+    U += head;
+    n -= head;
+    m -= tail;
+    T += head;
+    if (parallel && n + m >= parallel_merge_cutoff)
+    {
+        int p = omp_get_num_threads();
+#pragma omp taskloop grainsize(1)
+        for (int s = 0; s < p; s++)
+        {
+            int k0 = (long long)(n + m) * s / p;
+            int k1 = (long long)(n + m) * (s + 1) / p;
+            int i0 = co_rank(k0, U, n, V, m);
+            int i1 = co_rank(k1, U, n, V, m);
+            merge_gallop(U + i0, i1 - i0, V + k0 - i0, k1 - i1 - k0 + i0,
+                         T + k0);
+        }
+    }
+    else
+    {
+        merge_gallop(U, n, V, m, T);
+    }
+}
+
+/**********************************************
+ * @brief Merges the runs [first, last) of src into dst, src and dst
+ * holding the same values on entry
+ * @param src The scratch array, clobbered
+ * @param dst The array receiving the merged runs
+ * @param runs The runs
+ *
+ * The merge tree is the powersort one : the root is the boundary of
+ * smallest power, the left and right runs are merged recursively (in
+ * tasks above task_cutoff values). A single run is already in dst.
+ ***********************************************/
+static void merge_runs(int *src, int *dst, const runs_t *runs, int first,
+                       int last)
+{
+    if (last - first < 2)
+        return;
+
+    int mid = first + 1;
+    for (int r = first + 2; r < last; r++)
+    {
+        if (runs->power[r] < runs->power[mid])
+        {
+            mid = r;
+        }
+    }
+
+    const int *start = runs->start;
+    int lo = start[first], split = start[mid], hi = start[last];
+    if (hi - lo > task_cutoff)
+    {
+#pragma omp task
+        merge_runs(dst, src, runs, first, mid);
+        merge_runs(dst, src, runs, mid, last);
+#pragma omp taskwait
+        fusion_gallop(src + lo, split - lo, src + split, hi - split, dst + lo,
+                      1);
+    }
+    else
+    {
+        merge_runs(dst, src, runs, first, mid);
+        merge_runs(dst, src, runs, mid, last);
+        fusion_gallop(src + lo, split - lo, src + split, hi - split, dst + lo,
+                      0);
+    }
+}
+
+/**********************************************
+ * @brief Sorts an array of integers by merging its natural runs, with
+ * OpenMP
+ * @param tab The array to sort
+ * @param n The size of the array
+ *
+ * The threads cut the array into ascending runs (descending ones are
+ * reversed, short ones extended by insertion, disordered blocks sorted in
+ * place), then the runs are merged along the powersort tree, galloping
+ * through the stretches of one run. A sorted input costs one
+ * parallel scan, random input the work of tri_fusion_omp.
+ *
+ * @code
+ * decouper T en runs croissants (en parallele)
+ * si un seul run : fin
+ * fusionner les runs selon l'arbre de powersort (taches)
+ * @endcode
+ ***********************************************/
+int tri_adaptive(int *tab, int n)
+{
+    if (n < 2)
+        return 0;
+
+    int *buf = malloc(n * sizeof(int));
+    runs_t runs;
+    if (buf == NULL || detect_runs(tab, buf, n, &runs) != 0)
+    {
+        free(buf);
+        return -1;
+    }
+
+    if (runs.count > 1)
+    {
+#pragma omp parallel
+#pragma omp single
+        {
+#pragma omp taskloop
+            for (int i = 0; i < n; i++)
+            {
+                buf[i] = tab[i];
+            }
+
+            merge_runs(buf, tab, &runs, 0, runs.count);
+        }
+    }
+
+    free(runs.start);
+    free(runs.power);
+    free(buf);
+    return 0;
+}
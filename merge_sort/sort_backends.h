@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * @file sort_backends.h
+ * @brief Sorts of ints behind psort_sort(), one per backend and algorithm.
+ * Internal to libpsort : the drivers and services use psort.h.
+ *
+ * The sorts return 0, or -1 when an allocation fails : they allocate before
+ * moving any value, so tab is then unchanged.
+ ******************************************************************************/
+#ifndef SORT_BACKENDS_H
+#define SORT_BACKENDS_H
+
+/**********************************************
+ * Default size below which tri_fusion_omp sorts without creating tasks
+ ***********************************************/
+#ifndef TASK_CUTOFF
+#define TASK_CUTOFF (1 << 15)
+#endif
+
+/**********************************************
+ * @brief Task cutoff used by the OpenMP sorts, see tunables.c
+ ***********************************************/
+extern int task_cutoff;
+
+/**********************************************
+ * @brief Sequential kernel of the OpenMP sorts : sorts src into dst without
+ * creating tasks, src and dst holding the same values on entry
+ * @param src The scratch array, clobbered
+ * @param dst The array receiving the sorted values
+ * @param n The size of both arrays
+ ***********************************************/
+void tri_fusion_seq(int *src, int *dst, int n);
+
+/**********************************************
+ * @brief Sequential merge sort
+ ***********************************************/
+int tri_fusion_sequential(int *tab, int n);
+
+/**********************************************
+ * @brief Parallel merge sort on the thread pool
+ * @param nb_threads The size of the pool if it does not exist yet,
+ * pool_default_size() if 0
+ ***********************************************/
+int tri_fusion_pth(int *tab, int n, int nb_threads);
+
+/**********************************************
+ * @brief Destroys the pool of tri_fusion_pth(), if any
+ ***********************************************/
+void sort_pthread_shutdown(void);
+
+/**********************************************
+ * @brief Parallel merge sort with OpenMP tasks
+ ***********************************************/
+int tri_fusion_omp(int *tab, int n);
+
+/**********************************************
+ * @brief Parallel sample sort with OpenMP
+ ***********************************************/
+int tri_echantillon(int *tab, int n);
+
+/**********************************************
+ * @brief Multiway merge sort with OpenMP and loser trees
+ ***********************************************/
+int tri_multiway(int *tab, int n);
+
+/**********************************************
+ * @brief Adaptive merge sort of the natural runs with OpenMP
+ ***********************************************/
+int tri_adaptive(int *tab, int n);
+
+/**********************************************
+ * @brief NUMA-aware merge sort with pinned OpenMP threads
+ ***********************************************/
+int tri_numa(int *tab, int n);
+
+/**********************************************
+ * @brief Merge sort with OpenMP in O(p sqrt(n)) extra memory, merging by
+ * block rotations
+ ***********************************************/
+int tri_inplace(int *tab, int n);
+
+/**********************************************
+ * @brief LSD radix sort with OpenMP, one byte per pass
+ ***********************************************/
+int tri_radix(int *tab, int n);
+
+#endif
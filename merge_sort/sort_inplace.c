@@ -0,0 +1,277 @@
+/*******************************************************************************
+ * @file sort_inplace.c
+ * @brief OpenMP backend of libpsort : in-place merge sort of ints, for when
+ * the n ints of a scratch array do not fit in memory
+ *
+ * The merges split both runs around a pivot and rotate the middle, until
+ * one side fits in a small per-thread buffer (about sqrt(n) ints) :
+ * O(p sqrt(n)) extra memory instead of n, for a log factor more data
+ * movement. Same tasks as tri_fusion_omp.
+ ******************************************************************************/
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fusion.h"
+#include "leaf_sort.h"
+#include "sort_backends.h"
+
+/**********************************************
+ * @brief The per-thread buffers of a sort
+ * @arg data The buffers, size ints per thread
+ * @arg size The size of each buffer
+ * @arg leaf The leaf_size of the sort, read once : leaf_sort() is never
+ * given more ints than a buffer holds
+ *
+ * A tied task only uses the buffer of its thread between two task
+ * scheduling points, so the tasks run by a thread never share it.
+ ***********************************************/
+typedef struct Inplace_buffers
+{
+    int *data;
+    int size;
+    int leaf;
+} inplace_buffers_t;
+
+static int *thread_buffer(const inplace_buffers_t *b)
+{
+    return b->data + (size_t)omp_get_thread_num() * b->size;
+}
+
+/**********************************************
+ * @brief Reverses tab[0..n-1], by all the threads if parallel and large
+ * enough
+ ***********************************************/
+static void reverse(int *tab, int n, int parallel)
+{
+    int half = n / 2;
+    if (parallel && n >= parallel_merge_cutoff)
+    {
+#pragma omp taskloop
+        for (int i = 0; i < half; i++)
+        {
+            int tmp = tab[i];
+            tab[i] = tab[n - 1 - i];
+            tab[n - 1 - i] = tmp;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < half; i++)
+        {
+            int tmp = tab[i];
+            tab[i] = tab[n - 1 - i];
+            tab[n - 1 - i] = tmp;
+        }
+    }
+}
+
+/**********************************************
+ * @brief Swaps the blocks tab[0..n-1] and tab[n..n+m-1]
+ *
+ * Through the buffer if the smaller block fits in it, else by three
+ * reversals.
+ ***********************************************/
+static void rotate(int *tab, int n, int m, const inplace_buffers_t *b,
+                   int parallel)
+{
+    if (n == 0 || m == 0)
+        return;
+
+    if (n <= m && n <= b->size)
+    {
+        int *buf = thread_buffer(b);
+        memcpy(buf, tab, n * sizeof(int));
+        memmove(tab, tab + n, m * sizeof(int));
+        memcpy(tab + m, buf, n * sizeof(int));
+    }
+    else if (m < n && m <= b->size)
+    {
+        int *buf = thread_buffer(b);
+        memcpy(buf, tab + n, m * sizeof(int));
+        memmove(tab + m, tab, n * sizeof(int));
+        memcpy(tab, buf, m * sizeof(int));
+    }
+    else
+    {
+        reverse(tab, n, parallel);
+        reverse(tab + n, m, parallel);
+        reverse(tab, n + m, parallel);
+    }
+}
+
+/**********************************************
+ * @brief Merges tab[0..n-1] and tab[n..n+m-1], the smaller one copied to
+ * buf first (it holds min(n, m) ints)
+ *
+ * A left copy is merged from the front, a right one from the back : the
+ * writes never pass the reads of the run left in place.
+ ***********************************************/
+static void fusion_buffer(int *tab, int n, int m, int *buf)
+{
+    if (n <= m)
+    {
+        memcpy(buf, tab, n * sizeof(int));
+        const int *V = tab + n;
+        int i = 0, j = 0, k = 0;
+        while (i < n && j < m)
+        {
+            int take_v = V[j] < buf[i];
+            tab[k++] = take_v ? V[j] : buf[i];
+            j += take_v;
+            i += !take_v;
+        }
+        memcpy(tab + k, buf + i, (n - i) * sizeof(int)); // V is in place
+    }
+    else
+    {
+        memcpy(buf, tab + n, m * sizeof(int));
+        int i = n - 1, j = m - 1, k = n + m - 1;
+        while (i >= 0 && j >= 0)
+        {
+            int take_u = buf[j] < tab[i];
+            tab[k--] = take_u ? tab[i] : buf[j];
+            i -= take_u;
+            j -= !take_u;
+        }
+        memcpy(tab, buf, (j + 1) * sizeof(int)); // U is in place
+    }
+}
+
+/**********************************************
+ * @brief Number of values of tab[0..n-1] smaller than x (or not greater
+ * than x if or_equal)
+ ***********************************************/
+static int bound(const int *tab, int n, int x, int or_equal)
+{
+    int lo = 0, hi = n;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (or_equal ? tab[mid] <= x : tab[mid] < x)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**********************************************
+ * @brief Merges the sorted arrays tab[0..n-1] and tab[n..n+m-1] in place
+ * @param b The per-thread buffers
+ * @param parallel 1 to split the work into tasks above task_cutoff values
+ *
+ * @code
+ * si le plus petit tableau tient dans le buffer : fusion classique
+ * couper le plus grand en son milieu, chercher le pivot dans l'autre
+ * tourner les deux blocs du milieu : U1 V1 U2 V2
+ * fusionner U1 V1 et U2 V2 (en parallele)
+ * @endcode
+ ***********************************************/
+static void fusion_inplace(int *tab, int n, int m, const inplace_buffers_t *b,
+                           int parallel)
+{
+    if (n == 0 || m == 0 || tab[n - 1] <= tab[n])
+        return;
+
+    if (n <= b->size || m <= b->size)
+    {
+        fusion_buffer(tab, n, m, thread_buffer(b));
+        return;
+    }
+
+    int cut_u, cut_v;
+    if (n >= m)
+    {
+        cut_u = n / 2;
+        cut_v = bound(tab + n, m, tab[cut_u], 0);
+    }
+    else
+    {
+        cut_v = m / 2;
+        cut_u = bound(tab, n, tab[n + cut_v], 1);
+    }
+    rotate(tab + cut_u, n - cut_u, cut_v, b, parallel);
+
+    int mid = cut_u + cut_v;
+    if (parallel && n + m > task_cutoff)
+    {
+#pragma omp task
+        fusion_inplace(tab, cut_u, cut_v, b, 1);
+        fusion_inplace(tab + mid, n - cut_u, m - cut_v, b, 1);
+#pragma omp taskwait
+    }
+    else
+    {
+        fusion_inplace(tab, cut_u, cut_v, b, 0);
+        fusion_inplace(tab + mid, n - cut_u, m - cut_v, b, 0);
+    }
+}
+
+/**********************************************
+ * @brief Recursive part of tri_inplace(), in tasks above task_cutoff values
+ ***********************************************/
+static void tri_inplace_rec(int *tab, int n, const inplace_buffers_t *b)
+{
+    if (n <= b->leaf)
+    {
+        leaf_sort(tab, thread_buffer(b), n);
+        return;
+    }
+
+    int mid = n / 2;
+    if (n > task_cutoff)
+    {
+#pragma omp task
+        tri_inplace_rec(tab, mid, b);
+        tri_inplace_rec(tab + mid, n - mid, b);
+#pragma omp taskwait
+        fusion_inplace(tab, mid, n - mid, b, 1);
+    }
+    else
+    {
+        tri_inplace_rec(tab, mid, b);
+        tri_inplace_rec(tab + mid, n - mid, b);
+        fusion_inplace(tab, mid, n - mid, b, 0);
+    }
+}
+
+/**********************************************
+ * @brief Sorts an array of integers in place with OpenMP
+ * @param tab The array to sort
+ * @param n The size of the array
+ *
+ * The buffers hold leaf_size ints, doubled until their square reaches n.
+ * Merge sort whose merges rotate blocks instead of writing to a scratch
+ * array : O(p sqrt(n)) extra ints for p threads, O(n log^2 n / p) work
+ * when the runs do not fit in the buffers.
+ ***********************************************/
+int tri_inplace(int *tab, int n)
+{
+    if (n < 2)
+        return 0;
+
+    int p = omp_get_max_threads();
+    inplace_buffers_t b;
+    b.leaf = leaf_size;
+    b.size = b.leaf;
+    while ((long long)b.size * b.size < n)
+    {
+        b.size *= 2;
+    }
+    b.data = malloc((size_t)p * b.size * sizeof(int));
+    if (b.data == NULL)
+        return -1;
+
+#pragma omp parallel
+#pragma omp single
+    tri_inplace_rec(tab, n, &b);
+
+    free(b.data);
+    return 0;
+}
@@ -0,0 +1,310 @@
+/*******************************************************************************
+ * @file sort_numa.c
+ * @brief OpenMP backend of libpsort : NUMA-aware merge sort of ints
+ *
+ * Every thread is pinned to a core and owns one contiguous chunk of the
+ * array and of the scratch buffer, placed on the node of its core (mbind,
+ * then first touch). The chunks of a node are consecutive : merges stay on
+ * the node until the last log2(nodes) rounds, and a thread only ever writes
+ * its own chunk. The topology is read from sysfs, without libnuma.
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "fusion.h"
+#include "sort_backends.h"
+
+/**********************************************
+ * Largest number of nodes handled, and mbind() constants of numaif.h
+ ***********************************************/
+#define NUMA_MAX_NODES 64
+#define NUMA_MPOL_PREFERRED 1
+#define NUMA_MPOL_MF_MOVE (1 << 1)
+
+/**********************************************
+ * @brief The cores this process may run on, grouped by node
+ * @arg nb_nodes The number of nodes with such cores
+ * @arg node The id of each of these nodes
+ * @arg first The index in cpu of the first core of each node,
+ * first[nb_nodes] = nb_cpus
+ * @arg cpu The cores, node by node
+ ***********************************************/
+typedef struct Topology
+{
+    int nb_nodes;
+    int node[NUMA_MAX_NODES];
+    int first[NUMA_MAX_NODES + 1];
+    int cpu[CPU_SETSIZE];
+} topology_t;
+
+static topology_t topology; // read once, by the first tri_numa()
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+
+/**********************************************
+ * @brief Adds the cpus of a sysfs list ("0-23,48-71") to a set
+ * @return 0, or -1 if the file cannot be read
+ ***********************************************/
+static int read_cpulist(const char *path, cpu_set_t *set)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return -1;
+
+    int lo, hi;
+    while (fscanf(file, "%d", &lo) == 1)
+    {
+        hi = lo;
+        int c = fgetc(file);
+        if (c == '-' && fscanf(file, "%d", &hi) == 1)
+        {
+            c = fgetc(file);
+        }
+        for (int cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; cpu++)
+        {
+            CPU_SET(cpu, set);
+        }
+        if (c != ',')
+            break;
+    }
+    fclose(file);
+    return 0;
+}
+
+/**********************************************
+ * @brief Reads the nodes and the cores allowed to this process into
+ * topology
+ *
+ * Without /sys/devices/system/node, all the allowed cores form one node.
+ ***********************************************/
+static void read_topology(void)
+{
+    topology_t *topo = &topology;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        CPU_SET(sched_getcpu() >= 0 ? sched_getcpu() : 0, &allowed);
+    }
+
+    int nb_cpus = 0;
+    topo->nb_nodes = 0;
+    for (int node = 0; node < NUMA_MAX_NODES; node++)
+    {
+        char path[64];
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+                 node);
+        if (read_cpulist(path, &cpus) != 0)
+            continue;
+
+        CPU_AND(&cpus, &cpus, &allowed);
+        if (CPU_COUNT(&cpus) == 0)
+            continue;
+
+        topo->node[topo->nb_nodes] = node;
+        topo->first[topo->nb_nodes++] = nb_cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &cpus))
+            {
+                topo->cpu[nb_cpus++] = cpu;
+                CPU_CLR(cpu, &allowed); // in one node only
+            }
+        }
+    }
+
+    if (topo->nb_nodes == 0) // no sysfs : one node
+    {
+        topo->node[0] = 0;
+        topo->first[0] = 0;
+        topo->nb_nodes = 1;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                topo->cpu[nb_cpus++] = cpu;
+            }
+        }
+    }
+    topo->first[topo->nb_nodes] = nb_cpus;
+}
+
+/**********************************************
+ * @brief Node index (in topo) of thread t of p : the threads are split
+ * between the nodes in proportion to their cores
+ ***********************************************/
+static int thread_node(const topology_t *topo, int t, int p)
+{
+    long nb_cpus = topo->first[topo->nb_nodes];
+    int k = 0;
+    while (k + 1 < topo->nb_nodes &&
+           (long)t * nb_cpus >= (long)topo->first[k + 1] * p)
+    {
+        k++;
+    }
+    return k;
+}
+
+/**********************************************
+ * @brief Core of thread t of p : the cores of its node in turn
+ ***********************************************/
+static int thread_cpu(const topology_t *topo, int t, int p)
+{
+    int k = thread_node(topo, t, p);
+    long nb_cpus = topo->first[topo->nb_nodes];
+    // first thread of node k
+    int t0 = ((long)topo->first[k] * p + nb_cpus - 1) / nb_cpus;
+    int size = topo->first[k + 1] - topo->first[k];
+    return topo->cpu[topo->first[k] + (t - t0) % size];
+}
+
+/**********************************************
+ * @brief Prefers the pages of [addr, addr + len) on a node, moving those
+ * already allocated (raw mbind, errors ignored : placement is a hint)
+ ***********************************************/
+static void place_on_node(void *addr, size_t len, int node)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    unsigned long lo = ((unsigned long)addr + page - 1) & ~(page - 1);
+    unsigned long hi = ((unsigned long)addr + len) & ~(page - 1);
+    if (hi <= lo)
+        return;
+
+    unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(long))] = {0};
+    mask[node / (8 * sizeof(long))] |= 1UL << (node % (8 * sizeof(long)));
+    syscall(SYS_mbind, lo, hi - lo, NUMA_MPOL_PREFERRED, mask,
+            NUMA_MAX_NODES + 1, NUMA_MPOL_MF_MOVE);
+}
+
+/**********************************************
+ * @brief Sorts an array of integers with pinned threads, each one working
+ * on its node's memory
+ * @param tab The array to sort
+ * @param n The size of the array
+ *
+ * Thread t owns tab and buf in [n t / p, n (t + 1) / p). Bottom-up :
+ * it sorts its chunk, then each round merges pairs of groups of chunks,
+ * every thread of a pair writing its own chunk of the output (merge-path
+ * slice). The pages of each node's chunks are moved or bound to it first.
+ *
+ * @code
+ * placer tab et buf : les morceaux de chaque noeud sur ce noeud
+ * chaque thread (fixe sur un coeur) trie son morceau
+ * pour w = 1, 2, 4... < p
+ *  fusionner les groupes de w morceaux deux a deux (tranche par thread)
+ * @endcode
+ ***********************************************/
+int tri_numa(int *tab, int n)
+{
+    if (n <= task_cutoff) // one task of tri_fusion_omp
+    {
+        return tri_fusion_omp(tab, n);
+    }
+
+    pthread_once(&topology_once, read_topology);
+    const topology_t *topo = &topology;
+    int p = omp_get_max_threads();
+    if (p > n)
+        p = n;
+
+    // on several nodes, untouched pages : each one lands where mbind or
+    // its first write says
+    size_t bytes = (size_t)n * sizeof(int);
+    int numa = topo->nb_nodes > 1;
+    int *buf = numa ? mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+                    : malloc(bytes);
+    if (buf == MAP_FAILED || buf == NULL)
+        return -1;
+
+    if (numa)
+    {
+        for (int t0 = 0; t0 < p;)
+        {
+            int k = thread_node(topo, t0, p);
+            int t1 = t0;
+            while (t1 < p && thread_node(topo, t1, p) == k)
+            {
+                t1++;
+            }
+            long lo = (long)n * t0 / p, hi = (long)n * t1 / p;
+            place_on_node(tab + lo, (hi - lo) * sizeof(int), topo->node[k]);
+            place_on_node(buf + lo, (hi - lo) * sizeof(int), topo->node[k]);
+            t0 = t1;
+        }
+    }
+
+#pragma omp parallel num_threads(p)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads(); // p unless the runtime gives less
+
+        cpu_set_t saved, pinned;
+        pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved);
+        CPU_ZERO(&pinned);
+        CPU_SET(thread_cpu(topo, t, nt), &pinned);
+        pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+
+        /**********************************************
+         * Local sort of the chunk, into tab
+         ***********************************************/
+        int lo = (long)n * t / nt;
+        int hi = (long)n * (t + 1) / nt;
+        memcpy(buf + lo, tab + lo, (hi - lo) * sizeof(int));
+        tri_fusion_seq(buf + lo, tab + lo, hi - lo);
+#pragma omp barrier
+
+        /**********************************************
+         * Merge rounds, ping-pong between tab and buf
+         ***********************************************/
+        int *src = tab, *dst = buf;
+        for (int w = 1; w < nt; w *= 2)
+        {
+            int a = t / (2 * w) * (2 * w); // first chunk of the pair
+            int b = a + w;                 // first chunk of the right group
+            int c = a + 2 * w < nt ? a + 2 * w : nt;
+            if (b >= nt) // no right group : the left one is copied
+            {
+                memcpy(dst + lo, src + lo, (hi - lo) * sizeof(int));
+            }
+            else
+            {
+                int s0 = (long)n * a / nt;
+                int s1 = (long)n * b / nt;
+                int s2 = (long)n * c / nt;
+                fusion_slice(lo - s0, hi - s0, src + s0, s1 - s0, src + s1,
+                             s2 - s1, dst + s0);
+            }
+            int *swap = src;
+            src = dst;
+            dst = swap;
+#pragma omp barrier
+        }
+
+        if (src != tab)
+        {
+            memcpy(tab + lo, src + lo, (hi - lo) * sizeof(int));
+        }
+
+        pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+    }
+
+    if (numa)
+    {
+        munmap(buf, bytes);
+    }
+    else
+    {
+        free(buf);
+    }
+    return 0;
+}
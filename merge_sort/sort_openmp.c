@@ -0,0 +1,566 @@
+/*******************************************************************************
+ * @file sort_openmp.c
+ * @brief OpenMP backend of libpsort : parallel merge sort, sample sort and
+ * multiway merge sort of ints
+ ******************************************************************************/
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fusion.h"
+#include "leaf_sort.h"
+#include "loser_tree.h"
+#include "perf_counters.h"
+#include "sort_backends.h"
+
+/**********************************************
+ * Sample sort : samples drawn per bucket, largest number of buckets (log2)
+ * and size below which it falls back to tri_fusion_omp
+ ***********************************************/
+#define SAMPLE_OVERSAMPLING 32
+#define SAMPLE_MAX_LOG 7
+#define SAMPLE_SORT_CUTOFF (1 << 16)
+
+/**********************************************
+ * Multiway merge sort : size of the blocks sorted in cache, and number of
+ * runs merged at once by a loser tree
+ ***********************************************/
+#define MULTIWAY_BLOCK (1 << 16)
+#define MULTIWAY_FAN_IN 64
+
+/**********************************************
+ * @brief The k - 1 splitters of a sample sort, in sorted order and as an
+ * implicit binary search tree (children of node j are 2j and 2j + 1)
+ * @arg k The number of buckets, a power of two
+ * @arg log_k log2(k)
+ * @arg tree The splitters in breadth-first order, tree[1] is the root
+ * @arg splitter The sorted splitters, splitter[k - 1] repeats
+ * splitter[k - 2] so that no value is equal to it
+ ***********************************************/
+typedef struct Splitters
+{
+    int k;
+    int log_k;
+    int tree[1 << SAMPLE_MAX_LOG];
+    int splitter[1 << SAMPLE_MAX_LOG];
+} splitters_t;
+
+
+/**********************************************
+ * @brief Merges two sorted arrays with all the threads (merge path)
+ * @param U The first sorted array
+ * @param n The size of the first array
+ * @param V The second sorted array
+ * @param m The size of the second array
+ * @param T The resulting merged array
+ * @param depth The depth of the merge in the recursion
+ *
+ * The output is cut in p slices of equal size, each task finds the start
+ * of its slice in U and V by binary search (co-rank) and merges it alone.
+ * Must be called from a task of the parallel region of tri_fusion_omp.
+ ***********************************************/
+static void fusion_parallel(const int *U, int n, const int *V, int m, int *T,
+                            int depth)
+{
+    int p = omp_get_num_threads();
+
+#pragma omp taskloop grainsize(1)
+    for (int s = 0; s < p; s++)
+    {
+        int k0 = (long long)(n + m) * s / p;
+        int k1 = (long long)(n + m) * (s + 1) / p;
+        perf_sample_t sample;
+        perf_begin(&sample);
+        fusion_slice(k0, k1, U, n, V, m, T);
+        size_t bytes = (k1 - k0) * sizeof(int);
+        perf_end(&sample, perf_merge_phase(depth), bytes, bytes);
+    }
+}
+
+/**********************************************
+ * @brief tri_fusion_seq() at some depth of the recursion
+ ***********************************************/
+static void tri_fusion_seq_rec(int *src, int *dst, int n, int depth)
+{
+    perf_sample_t s;
+    size_t bytes = n * sizeof(int);
+
+    if (n <= leaf_size)
+    {
+        perf_begin(&s);
+        leaf_sort(dst, src, n);
+        perf_end(&s, PERF_LEAF, bytes, bytes);
+        return;
+    }
+
+    int mid = n / 2;
+    tri_fusion_seq_rec(dst, src, mid, depth + 1);
+    tri_fusion_seq_rec(dst + mid, src + mid, n - mid, depth + 1);
+    perf_begin(&s);
+    fusion(src, mid, src + mid, n - mid, dst);
+    perf_end(&s, perf_merge_phase(depth), bytes, bytes);
+}
+
+void tri_fusion_seq(int *src, int *dst, int n)
+{
+    tri_fusion_seq_rec(src, dst, n, 0);
+}
+
+/**********************************************
+ * @brief Sorts src into dst with parallel merge sort, src and dst holding
+ * the same values on entry
+ * @param src The scratch array, clobbered
+ * @param dst The array receiving the sorted values
+ * @param n The size of both arrays
+ * @param depth The depth in the recursion, for perf_counters.h
+ *
+ * The halves are sorted into src, then merged into dst : the two buffers
+ * swap roles at each level instead of allocating U and V. Runs inside the
+ * single parallel region of tri_fusion_omp, each level only creates a task.
+ ***********************************************/
+static void tri_fusion_rec(int *src, int *dst, int n, int depth)
+{
+
+    /**********************************************
+     * Threshold case : not worth a task anymore
+     ***********************************************/
+    if (n <= task_cutoff)
+    {
+        tri_fusion_seq_rec(src, dst, n, depth);
+        return;
+    }
+
+    /**********************************************
+     * Starting recursion
+     ***********************************************/
+    int mid = n / 2;
+
+    /**********************************************
+     * Recursive sorting
+     ***********************************************/
+
+// Any idle thread sorts the first half, this one the second
+#pragma omp task
+    tri_fusion_rec(dst, src, mid, depth + 1);
+    tri_fusion_rec(dst + mid, src + mid, n - mid, depth + 1);
+#pragma omp taskwait
+
+    if (n >= parallel_merge_cutoff)
+    {
+        fusion_parallel(src, mid, src + mid, n - mid, dst, depth);
+    }
+    else
+    {
+        perf_sample_t s;
+        perf_begin(&s);
+        fusion(src, mid, src + mid, n - mid, dst);
+        perf_end(&s, perf_merge_phase(depth), n * sizeof(int),
+                 n * sizeof(int));
+    }
+}
+
+/**********************************************
+ * @brief Sorts an array of integers using parallel merge sort with OpenMP
+ * @param tab The array to sort
+ * @param n The size of the array
+ *
+ * The only allocation is one scratch buffer of n ints. One parallel region
+ * is opened for the whole sort : a single thread starts the recursion and
+ * the others run the tasks it creates (copy, halves and merge slices).
+ ***********************************************/
+int tri_fusion_omp(int *tab, int n)
+{
+    if (n < 2)
+        return 0;
+
+    int *buf = malloc(n * sizeof(int));
+    if (buf == NULL)
+        return -1;
+
+#pragma omp parallel
+#pragma omp single
+    {
+        int p = omp_get_num_threads();
+#pragma omp taskloop grainsize(1)
+        for (int s = 0; s < p; s++)
+        {
+            int lo = (long long)n * s / p;
+            int hi = (long long)n * (s + 1) / p;
+            perf_sample_t sample;
+            perf_begin(&sample);
+            memcpy(buf + lo, tab + lo, (hi - lo) * sizeof(int));
+            perf_end(&sample, PERF_COPY, (hi - lo) * sizeof(int),
+                     (hi - lo) * sizeof(int));
+        }
+
+        tri_fusion_rec(buf, tab, n, 0);
+    }
+
+    free(buf);
+    return 0;
+}
+
+/**********************************************
+ * @brief Fills the search tree of s from its sorted splitters
+ * @param s The splitters
+ * @param j The node to fill
+ * @param i The next splitter to place, in order
+ ***********************************************/
+static void fill_tree(splitters_t *s, int j, int *i)
+{
+    if (j >= s->k)
+        return;
+    fill_tree(s, 2 * j, i);
+    s->tree[j] = s->splitter[(*i)++];
+    fill_tree(s, 2 * j + 1, i);
+}
+
+/**********************************************
+ * @brief Picks the splitters of a sample sort of tab
+ * @param tab The array to sort
+ * @param n The size of the array
+ * @param s The splitters, s->k and s->log_k already set
+ *
+ * SAMPLE_OVERSAMPLING values per bucket are drawn at random and sorted,
+ * every SAMPLE_OVERSAMPLING-th one becomes a splitter.
+ ***********************************************/
+static void choose_splitters(const int *tab, int n, splitters_t *s)
+{
+    int a = SAMPLE_OVERSAMPLING * s->k;
+    int sample[a], scratch[a];
+    unsigned long long x = 88172645463325252ULL; // xorshift64 state
+
+    for (int i = 0; i < a; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        sample[i] = scratch[i] = tab[x % n];
+    }
+    tri_fusion_seq(scratch, sample, a);
+
+    for (int b = 0; b < s->k - 1; b++)
+    {
+        s->splitter[b] = sample[(b + 1) * SAMPLE_OVERSAMPLING - 1];
+    }
+    s->splitter[s->k - 1] = s->splitter[s->k - 2];
+
+    int i = 0;
+    fill_tree(s, 1, &i);
+}
+
+/**********************************************
+ * @brief Bucket of x : 2b for the values between splitter b - 1 (excluded)
+ * and splitter b, 2b + 1 for the values equal to splitter b
+ * @param s The splitters
+ * @param x The value to classify
+ *
+ * The descent in the tree has no branch : the next node is computed from
+ * the comparison, the loop always runs log_k times.
+ ***********************************************/
+static inline unsigned classify(const splitters_t *s, int x)
+{
+    unsigned j = 1;
+    for (int l = 0; l < s->log_k; l++)
+    {
+        j = 2 * j + (x > s->tree[j]);
+    }
+    unsigned b = j - s->k;
+    return 2 * b + (x == s->splitter[b]);
+}
+
+/**********************************************
+ * @brief Sorts an array of integers using parallel sample sort with OpenMP
+ * @param tab The array to sort
+ * @param n The size of the array
+ *
+ * One bucket per thread (rounded up to a power of two) : every thread
+ * classifies its block, the buckets are built in a scratch array and each
+ * one is sorted back into tab by its own task, with the tri_fusion_omp kernel.
+ * The values equal to a splitter get a bucket of their own that needs no
+ * sort, so many duplicates do not unbalance the buckets.
+ *
+ * @code
+ * tirer SAMPLE_OVERSAMPLING * k valeurs, les trier, garder k - 1 pivots
+ * chaque thread t : O[i] = seau de tab[i] pour i dans son bloc, H[t][O[i]]++
+ * deplacer tab[i] dans son seau de buf (positions par somme prefixe de H)
+ * pour chaque seau (en parallele) : trier buf[seau] dans tab[seau]
+ * @endcode
+ ***********************************************/
+int tri_echantillon(int *tab, int n)
+{
+    if (n < SAMPLE_SORT_CUTOFF)
+    {
+        return tri_fusion_omp(tab, n);
+    }
+
+    int p = omp_get_max_threads();
+    splitters_t s;
+    s.log_k = 1;
+    while ((1 << s.log_k) < p && s.log_k < SAMPLE_MAX_LOG)
+    {
+        s.log_k++;
+    }
+    s.k = 1 << s.log_k;
+    choose_splitters(tab, n, &s);
+
+    int nb = 2 * s.k; // buckets, counting the ones of equal values
+    int *buf = malloc(n * sizeof(int));
+    unsigned char *oracle = malloc(n);
+    long *hist = malloc((long)p * nb * sizeof(long));
+    long *start = malloc((nb + 1) * sizeof(long));
+    if (buf == NULL || oracle == NULL || hist == NULL || start == NULL)
+    {
+        free(buf);
+        free(oracle);
+        free(hist);
+        free(start);
+        return -1;
+    }
+
+#pragma omp parallel num_threads(p)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int lo = (long long)n * t / nt;
+        int hi = (long long)n * (t + 1) / nt;
+        long *h = hist + (long)t * nb;
+
+        /**********************************************
+         * Classification, four values at a time so that the four
+         * descents in the tree overlap
+         ***********************************************/
+        memset(h, 0, nb * sizeof(long));
+        int i = lo;
+        for (; i + 4 <= hi; i += 4)
+        {
+            unsigned b0 = classify(&s, tab[i]);
+            unsigned b1 = classify(&s, tab[i + 1]);
+            unsigned b2 = classify(&s, tab[i + 2]);
+            unsigned b3 = classify(&s, tab[i + 3]);
+            oracle[i] = b0;
+            oracle[i + 1] = b1;
+            oracle[i + 2] = b2;
+            oracle[i + 3] = b3;
+            h[b0]++;
+            h[b1]++;
+            h[b2]++;
+            h[b3]++;
+        }
+        for (; i < hi; i++)
+        {
+            oracle[i] = classify(&s, tab[i]);
+            h[oracle[i]]++;
+        }
+#pragma omp barrier
+
+        /**********************************************
+         * Start of each bucket, and of each thread inside each bucket
+         ***********************************************/
+#pragma omp single
+        {
+            long sum = 0;
+            for (int b = 0; b < nb; b++)
+            {
+                start[b] = sum;
+                for (int u = 0; u < nt; u++)
+                {
+                    long c = hist[(long)u * nb + b];
+                    hist[(long)u * nb + b] = sum;
+                    sum += c;
+                }
+            }
+            start[nb] = sum;
+        }
+
+        /**********************************************
+         * Distribution into the buckets
+         ***********************************************/
+        for (i = lo; i < hi; i++)
+        {
+            buf[h[oracle[i]]++] = tab[i];
+        }
+#pragma omp barrier
+
+        /**********************************************
+         * Sort of each bucket back into tab
+         ***********************************************/
+#pragma omp single
+        for (int b = 0; b < nb; b++)
+        {
+            long len = start[b + 1] - start[b];
+            if (len == 0)
+                continue;
+
+#pragma omp task
+            {
+                memcpy(tab + start[b], buf + start[b], len * sizeof(int));
+                if (b % 2 == 0) // a bucket of equal values is sorted
+                {
+                    tri_fusion_rec(buf + start[b], tab + start[b], len, 0);
+                }
+            }
+        }
+    }
+
+    free(buf);
+    free(oracle);
+    free(hist);
+    free(start);
+    return 0;
+}
+
+/**********************************************
+ * @brief Merges the runs [first, last) of src into dst, one slice of the
+ * output
+ * @param src The array holding the sorted runs
+ * @param dst The array receiving the merged runs
+ * @param start The start of each run in src, start[last] its end
+ * @param first, last The runs to merge, at most MULTIWAY_FAN_IN
+ * @param r0, r1 The slice [r0, r1) of their merge to write
+ ***********************************************/
+static void fusion_k_slice(const int *src, int *dst, const int *start,
+                           int first, int last, long r0, long r1)
+{
+    int k = last - first;
+    const int *U[MULTIWAY_FAN_IN] = {NULL};
+    int n[MULTIWAY_FAN_IN] = {0};
+    int pos0[MULTIWAY_FAN_IN], pos1[MULTIWAY_FAN_IN];
+
+    for (int i = 0; i < k; i++)
+    {
+        U[i] = src + start[first + i];
+        n[i] = start[first + i + 1] - start[first + i];
+    }
+    co_rank_k(r0, U, n, k, pos0);
+    co_rank_k(r1, U, n, k, pos1);
+    for (int i = 0; i < k; i++)
+    {
+        U[i] += pos0[i];
+        n[i] = pos1[i] - pos0[i];
+    }
+    fusion_k(U, n, k, dst + start[first] + r0);
+}
+
+/**********************************************
+ * @brief Sorts an array of integers using parallel multiway merge sort
+ * @param tab The array to sort
+ * @param n The size of the array
+ *
+ * The blocks of MULTIWAY_BLOCK values are sorted in cache with the
+ * tri_fusion_omp kernel, then merged MULTIWAY_FAN_IN at a time with a loser
+ * tree : log(n / MULTIWAY_BLOCK) / log(MULTIWAY_FAN_IN) passes over the
+ * memory (two for 200M values) instead of log2(n / leaf_size). Each merge
+ * is cut in slices merged by different tasks (co_rank_k).
+ *
+ * @code
+ * trier chaque bloc de B valeurs (en parallele)
+ * tant qu'il reste plus d'un run
+ *  fusionner les runs par groupes de K (tranches en parallele)
+ * @endcode
+ ***********************************************/
+int tri_multiway(int *tab, int n)
+{
+    if (n < 2)
+        return 0;
+
+    int nb_runs = (n + MULTIWAY_BLOCK - 1) / MULTIWAY_BLOCK;
+    int *buf = malloc(n * sizeof(int));
+    int *start = malloc((nb_runs + 1) * sizeof(int));
+    if (buf == NULL || start == NULL)
+    {
+        free(buf);
+        free(start);
+        return -1;
+    }
+    for (int i = 0; i < nb_runs; i++)
+    {
+        start[i] = i * MULTIWAY_BLOCK;
+    }
+    start[nb_runs] = n;
+
+    long slice = n / (4 * omp_get_max_threads());
+    if (slice < MULTIWAY_BLOCK)
+        slice = MULTIWAY_BLOCK;
+
+    // fewest passes of MULTIWAY_FAN_IN at most, then smallest fan-in
+    // doing it in as many passes (shallower trees)
+    int passes = 0;
+    for (long r = 1; r < nb_runs; r *= MULTIWAY_FAN_IN)
+    {
+        passes++;
+    }
+    int fan_in = 2;
+    for (;;)
+    {
+        long r = 1;
+        for (int p = 0; p < passes; p++)
+        {
+            r *= fan_in;
+        }
+        if (r >= nb_runs)
+            break;
+        fan_in++;
+    }
+
+#pragma omp parallel
+#pragma omp single
+    {
+        /**********************************************
+         * Blocks sorted in cache, into tab
+         ***********************************************/
+#pragma omp taskloop grainsize(1)
+        for (int i = 0; i < nb_runs; i++)
+        {
+            int len = start[i + 1] - start[i];
+            memcpy(buf + start[i], tab + start[i], len * sizeof(int));
+            tri_fusion_seq(buf + start[i], tab + start[i], len);
+        }
+
+        /**********************************************
+         * Merge passes, ping-pong between tab and buf
+         ***********************************************/
+        int *src = tab, *dst = buf;
+        while (nb_runs > 1)
+        {
+            for (int g = 0; g < nb_runs; g += fan_in)
+            {
+                int last = g + fan_in < nb_runs ? g + fan_in : nb_runs;
+                long len = start[last] - start[g];
+                for (long r0 = 0; r0 < len; r0 += slice)
+                {
+                    long r1 = r0 + slice < len ? r0 + slice : len;
+#pragma omp task
+                    fusion_k_slice(src, dst, start, g, last, r0, r1);
+                }
+            }
+#pragma omp taskwait
+
+            int groups = 0;
+            for (int g = 0; g < nb_runs; g += fan_in)
+            {
+                start[groups++] = start[g];
+            }
+            start[groups] = n;
+            nb_runs = groups;
+
+            int *swap = src;
+            src = dst;
+            dst = swap;
+        }
+
+        if (src != tab)
+        {
+#pragma omp taskloop
+            for (int i = 0; i < n; i++)
+            {
+                tab[i] = src[i];
+            }
+        }
+    }
+
+    free(buf);
+    free(start);
+    return 0;
+}
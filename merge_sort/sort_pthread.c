@@ -0,0 +1,266 @@
+/*******************************************************************************
+ * @file sort_pthread.c
+ * @brief Pthread backend of libpsort : parallel merge sort of ints on a
+ * work-stealing thread pool
+ ******************************************************************************/
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fusion.h"
+#include "leaf_sort.h"
+#include "perf_counters.h"
+#include "sort_backends.h"
+#include "thread_pool.h"
+
+static pool_t *pool; // Workers running tri_fusion_pth, created once
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**********************************************
+ * @brief A task requires a struct to pass multiple arguments
+ * @arg n The size of the array
+ * @arg tab The array to sort
+ * @arg buf The scratch array, tab and buf swap roles at each level
+ * @arg depth The depth of this node in the recursion
+ ***********************************************/
+typedef struct Thread_data
+{
+    int n;
+    int *tab;
+    int *buf; // scratch array holding the same values as tab on entry
+    int depth;
+} data_t;
+
+/**********************************************
+ * @brief Again, we need to pass multiple arguments to a task
+ * The goal is to do a parallel copy of tab into the scratch array
+ *
+ * @arg n The number of values to copy
+ * @arg to_copy The array to copy
+ * @arg to_paste The array to paste into
+ ***********************************************/
+typedef struct Copy_data
+{
+    int n;
+    const int *to_copy;
+    int *to_paste;
+} copy_t;
+
+/**********************************************
+ * @brief Arguments of a task merging one slice of a parallel merge
+ * @arg k0, k1 The slice [k0, k1) of the merged array
+ * @arg u, v The two sorted arrays
+ * @arg T The merged array
+ ***********************************************/
+typedef struct Slice_data
+{
+    int k0;
+    int k1;
+    data_t u;
+    data_t v;
+    int *T;
+} slice_t;
+
+/**********************************************
+ * @brief Copies one slice of an array into another array
+ * @param arg {n, to_copy, to_paste}
+ ***********************************************/
+static void copy_array(void *arg)
+{
+    copy_t *data = (copy_t *)arg;
+    perf_sample_t s;
+    perf_begin(&s);
+    memcpy(data->to_paste, data->to_copy, data->n * sizeof(int));
+    perf_end(&s, PERF_COPY, data->n * sizeof(int), data->n * sizeof(int));
+}
+
+/**********************************************
+ * @brief Merges one slice of a parallel merge
+ * @param arg {k0, k1, u, v, T}
+ ***********************************************/
+static void fusion_slice_task(void *arg)
+{
+    slice_t *s = (slice_t *)arg;
+    perf_sample_t sample;
+    perf_begin(&sample);
+    fusion_slice(s->k0, s->k1, s->u.tab, s->u.n, s->v.tab, s->v.n, s->T);
+    size_t bytes = (s->k1 - s->k0) * sizeof(int);
+    // u is one level below the merge
+    perf_end(&sample, perf_merge_phase(s->u.depth - 1), bytes, bytes);
+}
+
+/**********************************************
+ * @brief Merges two sorted arrays with p tasks (merge path)
+ * @param u {n, tab} array 1
+ * @param v {n, tab} array 2
+ * @param T The resulting merged array
+ * @param p The number of tasks
+ *
+ * The output is cut in p slices of equal size, each task finds the start
+ * of its slice in u and v by binary search (co-rank) and merges it alone.
+ ***********************************************/
+static void fusion_parallel(data_t u, data_t v, int *T, int p)
+{
+    task_t tasks[p];
+    slice_t slices[p];
+    int n = u.n + v.n;
+
+    for (int s = 0; s < p; s++)
+    {
+        slices[s] = (slice_t){(long long)n * s / p, (long long)n * (s + 1) / p,
+                              u, v, T};
+    }
+
+    // idle workers steal the slices 1..p-1
+    for (int s = 1; s < p; s++)
+    {
+        pool_submit(pool, &tasks[s], fusion_slice_task, &slices[s]);
+    }
+
+    // this worker merges the first slice
+    fusion_slice_task(&slices[0]);
+
+    for (int s = 1; s < p; s++)
+    {
+        pool_join(pool, &tasks[s]);
+    }
+}
+
+/**********************************************
+ * @brief Sorts t->buf into t->tab using parallel merge sort on the pool
+ * @param arg {n, tab, buf, depth}, tab and buf holding the same values on
+ * entry
+ *
+ * The halves are sorted into buf (the two arrays swap roles), then merged
+ * back into tab : no copy and no allocation per level.
+ ***********************************************/
+static void tri_fusion_pth_rec(void *arg)
+{
+    data_t *t = (data_t *)arg;
+    perf_sample_t s;
+    size_t bytes = t->n * sizeof(int);
+
+    /**********************************************
+     * Base case
+     ***********************************************/
+    if (t->n <= leaf_size)
+    {
+        perf_begin(&s);
+        leaf_sort(t->tab, t->buf, t->n);
+        perf_end(&s, PERF_LEAF, bytes, bytes);
+        return;
+    }
+
+    /**********************************************
+     * Starting recursion
+     ***********************************************/
+    int mid = t->n / 2;
+
+    data_t u = {mid, t->buf, t->tab, t->depth + 1};
+    data_t v = {t->n - mid, t->buf + mid, t->tab + mid, t->depth + 1};
+
+    /**********************************************
+     * Recursive sorting
+     ***********************************************/
+    task_t child;
+
+    // an idle worker steals the first half, or this one sorts it after v
+    pool_submit(pool, &child, tri_fusion_pth_rec, &u);
+
+    // this worker sorts the second half into v
+    tri_fusion_pth_rec(&v);
+    pool_join(pool, &child);
+
+    /**********************************************
+     * Merging, with a share of the workers (2^depth nodes of the same level
+     * are merging at the same time)
+     ***********************************************/
+    int p = pool_size(pool) >> t->depth;
+    if (p > 1 && t->n >= parallel_merge_cutoff)
+    {
+        fusion_parallel(u, v, t->tab, p);
+    }
+    else
+    {
+        perf_begin(&s);
+        fusion(u.tab, u.n, v.tab, v.n, t->tab);
+        perf_end(&s, perf_merge_phase(t->depth), bytes, bytes);
+    }
+}
+
+/**********************************************
+ * @brief First task of a sort : parallel copy of tab into buf, then the
+ * recursion
+ * @param arg {n, tab, buf, 0}
+ ***********************************************/
+static void tri_fusion_pth_root(void *arg)
+{
+    data_t *t = (data_t *)arg;
+    int p = pool_size(pool);
+    task_t tasks[p];
+    copy_t slices[p];
+
+    for (int s = 0; s < p; s++)
+    {
+        int lo = (long long)t->n * s / p;
+        int hi = (long long)t->n * (s + 1) / p;
+        slices[s] = (copy_t){hi - lo, t->tab + lo, t->buf + lo};
+    }
+    for (int s = 1; s < p; s++)
+    {
+        pool_submit(pool, &tasks[s], copy_array, &slices[s]);
+    }
+    copy_array(&slices[0]);
+    for (int s = 1; s < p; s++)
+    {
+        pool_join(pool, &tasks[s]);
+    }
+
+    tri_fusion_pth_rec(t);
+}
+
+/**********************************************
+ * @brief Sorts an array of integers using parallel merge sort with pthread
+ * @param tab The array to sort
+ * @param n The size of the array
+ * @param nb_threads The size of the pool, pool_default_size() if 0
+ *
+ * The only allocation is one scratch buffer of n ints. The pool is created
+ * by the first sort and reused by the next ones, whatever their
+ * nb_threads, until sort_pthread_shutdown().
+ ***********************************************/
+int tri_fusion_pth(int *tab, int n, int nb_threads)
+{
+    if (n < 2)
+        return 0;
+
+    pthread_mutex_lock(&pool_lock);
+    if (pool == NULL)
+    {
+        pool = pool_create(nb_threads > 0 ? nb_threads : pool_default_size());
+    }
+    pthread_mutex_unlock(&pool_lock);
+    if (pool == NULL)
+        return -1;
+
+    data_t t = {n, tab, malloc(n * sizeof(int)), 0};
+    if (t.buf == NULL)
+        return -1;
+
+    pool_run(pool, tri_fusion_pth_root, &t);
+
+    free(t.buf);
+    return 0;
+}
+
+void sort_pthread_shutdown(void)
+{
+    pthread_mutex_lock(&pool_lock);
+    if (pool != NULL)
+    {
+        pool_destroy(pool);
+        pool = NULL;
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
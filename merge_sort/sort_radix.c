@@ -0,0 +1,198 @@
+/*******************************************************************************
+ * @file sort_radix.c
+ * @brief OpenMP backend of libpsort : parallel LSD radix sort of 32-bit
+ * integers
+ *
+ * The array is sorted one byte at a time, from the least significant one :
+ * every thread counts the digits of its block, the offsets are obtained by
+ * a parallel prefix over (bucket, thread), then every thread scatters its
+ * block through write-combining buffers.
+ ******************************************************************************/
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sort_backends.h"
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (32 / RADIX_BITS)
+
+/**********************************************
+ * Values buffered per bucket before being written, one cache line
+ ***********************************************/
+#define WC_SIZE 16
+
+/**********************************************
+ * @brief Digit of x at the given shift
+ *
+ * The sign bit is flipped so that negative values, seen as unsigned, come
+ * before the positive ones.
+ ***********************************************/
+static inline unsigned digit(unsigned x, int shift)
+{
+    return ((x ^ 0x80000000u) >> shift) & (RADIX_BUCKETS - 1);
+}
+
+/**********************************************
+ * @brief Scatters src[lo..hi-1] to dst at the offsets of this thread
+ * @param offset The next free position of each bucket, updated
+ *
+ * Values are first gathered per bucket in a buffer of WC_SIZE ints, then
+ * written one full cache line at a time : the 256 output streams no longer
+ * thrash the cache and the TLB with scattered single-int stores.
+ ***********************************************/
+static void scatter(const unsigned *src, unsigned *dst, int lo, int hi,
+                    int shift, long *offset)
+{
+    _Alignas(64) unsigned wc[RADIX_BUCKETS][WC_SIZE];
+    int wc_n[RADIX_BUCKETS] = {0};
+
+    for (int i = lo; i < hi; i++)
+    {
+        unsigned x = src[i];
+        unsigned b = digit(x, shift);
+        wc[b][wc_n[b]++] = x;
+        if (wc_n[b] == WC_SIZE)
+        {
+            memcpy(dst + offset[b], wc[b], WC_SIZE * sizeof(unsigned));
+            offset[b] += WC_SIZE;
+            wc_n[b] = 0;
+        }
+    }
+
+    // flush the partially filled buffers
+    for (int b = 0; b < RADIX_BUCKETS; b++)
+    {
+        memcpy(dst + offset[b], wc[b], wc_n[b] * sizeof(unsigned));
+        offset[b] += wc_n[b];
+    }
+}
+
+/**********************************************
+ * @brief Sorts an array of integers using parallel LSD radix sort
+ * @param tab The array to sort
+ * @param n The size of the array
+ *
+ * Uses one scratch array of n ints, the passes alternate between tab and
+ * it. A pass whose digit is the same for every value is skipped.
+ *
+ * @code
+ * pour chaque octet, du moins au plus significatif
+ *  chaque thread t compte les chiffres de son bloc : H[t][b]
+ *  O[t][b] = somme des H[t'][b'] pour b' < b, ou b' = b et t' < t
+ *  chaque thread t place ses valeurs de chiffre b a partir de O[t][b]
+ * @endcode
+ ***********************************************/
+int tri_radix(int *tab, int n)
+{
+    if (n < 2)
+        return 0;
+
+    int p = omp_get_max_threads();
+    unsigned *buf = malloc(n * sizeof(unsigned));
+    long(*hist)[RADIX_BUCKETS] = malloc(p * sizeof(*hist));
+    long *range_sum = malloc(p * sizeof(long));
+    long count[RADIX_BUCKETS];
+    if (buf == NULL || hist == NULL || range_sum == NULL)
+    {
+        free(buf);
+        free(hist);
+        free(range_sum);
+        return -1;
+    }
+
+#pragma omp parallel num_threads(p)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int lo = (long long)n * t / nt;
+        int hi = (long long)n * (t + 1) / nt;
+        int b_lo = RADIX_BUCKETS * t / nt;
+        int b_hi = RADIX_BUCKETS * (t + 1) / nt;
+
+        unsigned *src = (unsigned *)tab;
+        unsigned *dst = buf;
+
+        for (int pass = 0; pass < RADIX_PASSES; pass++)
+        {
+            int shift = pass * RADIX_BITS;
+
+            /**********************************************
+             * Histogram of the block of this thread
+             ***********************************************/
+            long *h = hist[t];
+            memset(h, 0, RADIX_BUCKETS * sizeof(long));
+            for (int i = lo; i < hi; i++)
+            {
+                h[digit(src[i], shift)]++;
+            }
+#pragma omp barrier
+
+            /**********************************************
+             * Parallel prefix, each thread owns a range of buckets : the
+             * offsets of the threads inside each bucket first...
+             ***********************************************/
+            long sum = 0;
+            for (int b = b_lo; b < b_hi; b++)
+            {
+                long total = 0;
+                for (int u = 0; u < nt; u++)
+                {
+                    long c = hist[u][b];
+                    hist[u][b] = total;
+                    total += c;
+                }
+                count[b] = total;
+                sum += total;
+            }
+            range_sum[t] = sum;
+#pragma omp barrier
+
+            /**********************************************
+             * ... then the start of each bucket
+             ***********************************************/
+            long base = 0;
+            for (int u = 0; u < t; u++)
+            {
+                base += range_sum[u];
+            }
+            for (int b = b_lo; b < b_hi; b++)
+            {
+                for (int u = 0; u < nt; u++)
+                {
+                    hist[u][b] += base;
+                }
+                base += count[b];
+            }
+#pragma omp barrier
+
+            /**********************************************
+             * Scatter, unless every value has the same digit
+             ***********************************************/
+            if (count[digit(src[0], shift)] == n)
+            {
+                continue;
+            }
+            scatter(src, dst, lo, hi, shift, hist[t]);
+#pragma omp barrier
+
+            unsigned *swap = src;
+            src = dst;
+            dst = swap;
+        }
+
+        /**********************************************
+         * An odd number of passes leaves the result in buf
+         ***********************************************/
+        if (src != (unsigned *)tab)
+        {
+            memcpy(tab + lo, src + lo, (hi - lo) * sizeof(int));
+        }
+    }
+
+    free(buf);
+    free(hist);
+    free(range_sum);
+    return 0;
+}
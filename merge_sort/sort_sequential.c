@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * @file sort_sequential.c
+ * @brief Sequential backend of libpsort : recursive merge sort of ints,
+ * algorithm from the course "Parallel programming on parallel and
+ * distributed systems" at the UQAC.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fusion.h"
+#include "leaf_sort.h"
+#include "perf_counters.h"
+#include "sort_backends.h"
+
+/**********************************************
+ * @brief Sorts src into dst, src and dst holding the same values on entry
+ * @param src The scratch array, clobbered
+ * @param dst The array receiving the sorted values
+ * @param n The size of both arrays
+ * @param depth The depth in the recursion, for perf_counters.h
+ *
+ * The two halves are sorted into src (the buffers swap roles at each
+ * level), then merged back into dst : no copy and no allocation per level.
+ *
+ * @code
+ * procedure tri fusion rec(S[1..n], D[1..n])
+ *  si n <= leaf_size
+ *      leaf sort(D[1..n])
+ *  sinon
+ *      tri fusion rec(D[1..n/2], S[1..n/2])
+ *      tri fusion rec(D[1+n/2..n], S[1+n/2..n])
+ *      fusion(S[1..n/2],S[1+n/2..n],D)
+ * @endcode
+ ***********************************************/
+static void tri_fusion_sequential_rec(int *src, int *dst, int n, int depth)
+{
+    perf_sample_t s;
+    size_t bytes = n * sizeof(int);
+
+    if (n <= leaf_size)
+    {
+        perf_begin(&s);
+        leaf_sort(dst, src, n);
+        perf_end(&s, PERF_LEAF, bytes, bytes);
+        return;
+    }
+
+    /**********************************************
+     * Sort the two parts into src + merge them into dst
+     ***********************************************/
+    int mid = n / 2;
+    tri_fusion_sequential_rec(dst, src, mid, depth + 1);
+    tri_fusion_sequential_rec(dst + mid, src + mid, n - mid, depth + 1);
+    perf_begin(&s);
+    fusion(src, mid, src + mid, n - mid, dst);
+    perf_end(&s, perf_merge_phase(depth), bytes, bytes);
+}
+
+/**********************************************
+ * @brief Sorts an array of integers using recursive merge sort
+ * @param tab The array to sort
+ * @param n The size of the array
+ *
+ * A single scratch buffer of n ints is allocated, the recursion then
+ * alternates between tab and this buffer.
+ ***********************************************/
+int tri_fusion_sequential(int *tab, int n)
+{
+    if (n < 2)
+        return 0;
+
+    int *buf = malloc(n * sizeof(int));
+    if (buf == NULL)
+        return -1;
+    perf_sample_t s;
+    perf_begin(&s);
+    memcpy(buf, tab, n * sizeof(int));
+    perf_end(&s, PERF_COPY, n * sizeof(int), n * sizeof(int));
+
+    tri_fusion_sequential_rec(buf, tab, n, 0);
+
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,408 @@
+/*******************************************************************************
+ * @file thread_pool.c
+ * @brief Work-stealing thread pool, Chase-Lev deques with the C11 memory
+ * orderings of Le, Pop, Cohen and Zappa Nardelli (PPoPP 2013).
+ ******************************************************************************/
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+/**********************************************
+ * Capacity of a deque, a power of two. The recursion of a sort pushes one
+ * task per level plus the slices of a merge, far below this.
+ ***********************************************/
+#define DEQUE_CAPACITY 4096
+
+/**********************************************
+ * Unsuccessful rounds of stealing before an idle worker goes to sleep
+ ***********************************************/
+#define IDLE_ROUNDS 64
+
+/**********************************************
+ * @brief Chase-Lev deque : the owner pushes and takes at the bottom,
+ * thieves steal at the top. top and bottom sit on their own cache lines.
+ ***********************************************/
+typedef struct Deque
+{
+    _Alignas(64) atomic_long top;
+    _Alignas(64) atomic_long bottom;
+    _Alignas(64) _Atomic(task_t *) buffer[DEQUE_CAPACITY];
+} deque_t;
+
+/**********************************************
+ * @brief A worker thread and its deque
+ ***********************************************/
+typedef struct Worker
+{
+    deque_t deque;
+    pool_t *pool;
+    int id;
+    pthread_t thread;
+} worker_t;
+
+struct Thread_pool
+{
+    int nb_workers;
+    worker_t *workers;
+    atomic_int stop;
+
+    // Sleeping workers and tasks of external threads
+    pthread_mutex_t lock;
+    pthread_cond_t wake;     // a task was pushed
+    pthread_cond_t finished; // an injected task is done
+    atomic_long epoch;       // incremented by every push
+    atomic_int sleeping;
+    task_t *_Atomic injected;
+};
+
+static _Thread_local worker_t *current_worker = NULL;
+
+/**********************************************
+ * Deque operations
+ ***********************************************/
+
+static int deque_push(deque_t *d, task_t *task)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= DEQUE_CAPACITY)
+    {
+        return 0;
+    }
+    atomic_store_explicit(&d->buffer[b & (DEQUE_CAPACITY - 1)], task,
+                          memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+    return 1;
+}
+
+static task_t *deque_take(deque_t *d)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    task_t *task = NULL;
+    if (t <= b)
+    {
+        task = atomic_load_explicit(&d->buffer[b & (DEQUE_CAPACITY - 1)],
+                                    memory_order_relaxed);
+        if (t == b)
+        {
+            // last task, race against the thieves
+            if (!atomic_compare_exchange_strong_explicit(
+                    &d->top, &t, t + 1, memory_order_seq_cst,
+                    memory_order_relaxed))
+            {
+                task = NULL;
+            }
+            atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        }
+    }
+    else
+    {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static task_t *deque_steal(deque_t *d)
+{
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b)
+    {
+        return NULL;
+    }
+    task_t *task = atomic_load_explicit(&d->buffer[t & (DEQUE_CAPACITY - 1)],
+                                        memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed))
+    {
+        return NULL;
+    }
+    return task;
+}
+
+/**********************************************
+ * Scheduling
+ ***********************************************/
+
+/**********************************************
+ * @brief Wakes the sleeping workers after a push
+ ***********************************************/
+static void pool_notify(pool_t *pool)
+{
+    atomic_fetch_add(&pool->epoch, 1);
+    if (atomic_load(&pool->sleeping) > 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/**********************************************
+ * @brief Pops a task of the injection queue
+ ***********************************************/
+static task_t *pool_take_injected(pool_t *pool)
+{
+    if (atomic_load(&pool->injected) == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_lock(&pool->lock);
+    task_t *task = atomic_load(&pool->injected);
+    if (task != NULL)
+    {
+        atomic_store(&pool->injected, task->next);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return task;
+}
+
+/**********************************************
+ * @brief Next task for worker w : its own deque, then one steal attempt on
+ * every other worker, starting from a rotating victim
+ ***********************************************/
+static task_t *find_task(worker_t *w, unsigned *victim)
+{
+    pool_t *pool = w->pool;
+    task_t *task = deque_take(&w->deque);
+    if (task != NULL)
+    {
+        return task;
+    }
+    for (int i = 0; i < pool->nb_workers; i++)
+    {
+        worker_t *v = &pool->workers[(*victim + i) % pool->nb_workers];
+        if (v != w && (task = deque_steal(&v->deque)) != NULL)
+        {
+            *victim = v->id;
+            return task;
+        }
+    }
+    *victim = (*victim + 1) % pool->nb_workers;
+    return NULL;
+}
+
+static void run_task(task_t *task)
+{
+    task->fn(task->arg);
+    atomic_store_explicit(&task->done, 1, memory_order_release);
+}
+
+/**********************************************
+ * @brief Main loop of a worker
+ *
+ * An idle worker first keeps stealing for IDLE_ROUNDS rounds, then sleeps
+ * until the next push. The epoch is read before the last round : a push
+ * made after it changes the epoch, so the wake-up cannot be missed.
+ ***********************************************/
+static void *worker_main(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    pool_t *pool = w->pool;
+    unsigned victim = w->id + 1;
+    int idle = 0;
+
+    current_worker = w;
+    while (!atomic_load(&pool->stop))
+    {
+        long epoch = atomic_load(&pool->epoch);
+
+        task_t *task = pool_take_injected(pool);
+        if (task != NULL)
+        {
+            run_task(task);
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_broadcast(&pool->finished);
+            pthread_mutex_unlock(&pool->lock);
+            idle = 0;
+            continue;
+        }
+
+        task = find_task(w, &victim);
+        if (task != NULL)
+        {
+            run_task(task);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < IDLE_ROUNDS)
+        {
+            sched_yield();
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->sleeping, 1);
+        while (atomic_load(&pool->epoch) == epoch && !atomic_load(&pool->stop))
+        {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        atomic_fetch_sub(&pool->sleeping, 1);
+        pthread_mutex_unlock(&pool->lock);
+        idle = 0;
+    }
+    return NULL;
+}
+
+/**********************************************
+ * Public interface
+ ***********************************************/
+
+pool_t *pool_create(int nb_workers)
+{
+    if (nb_workers < 1)
+    {
+        nb_workers = 1;
+    }
+    pool_t *pool = malloc(sizeof(pool_t));
+    worker_t *workers = aligned_alloc(64, nb_workers * sizeof(worker_t));
+    if (pool == NULL || workers == NULL)
+    {
+        free(pool);
+        free(workers);
+        return NULL;
+    }
+
+    pool->nb_workers = nb_workers;
+    pool->workers = workers;
+    atomic_init(&pool->stop, 0);
+    atomic_init(&pool->epoch, 0);
+    atomic_init(&pool->sleeping, 0);
+    atomic_init(&pool->injected, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+
+    for (int i = 0; i < nb_workers; i++)
+    {
+        atomic_init(&workers[i].deque.top, 0);
+        atomic_init(&workers[i].deque.bottom, 0);
+        workers[i].pool = pool;
+        workers[i].id = i;
+    }
+    for (int i = 0; i < nb_workers; i++)
+    {
+        int error = pthread_create(&workers[i].thread, NULL, worker_main,
+                                   &workers[i]);
+        if (error != 0)
+        {
+            pool->nb_workers = i; // stops the ones already started
+            pool_destroy(pool);
+            errno = error;
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void pool_destroy(pool_t *pool)
+{
+    atomic_store(&pool->stop, 1);
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->nb_workers; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->finished);
+    free(pool->workers);
+    free(pool);
+}
+
+int pool_size(pool_t *pool)
+{
+    return pool->nb_workers;
+}
+
+void pool_run(pool_t *pool, void (*fn)(void *), void *arg)
+{
+    task_t task = {fn, arg, 0, NULL};
+
+    pthread_mutex_lock(&pool->lock);
+    task_t *last = atomic_load(&pool->injected);
+    if (last == NULL)
+    {
+        atomic_store(&pool->injected, &task);
+    }
+    else
+    {
+        while (last->next != NULL)
+        {
+            last = last->next;
+        }
+        last->next = &task;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    pool_notify(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (!atomic_load_explicit(&task.done, memory_order_acquire))
+    {
+        pthread_cond_wait(&pool->finished, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_submit(pool_t *pool, task_t *task, void (*fn)(void *), void *arg)
+{
+    task->fn = fn;
+    task->arg = arg;
+    task->next = NULL;
+    atomic_init(&task->done, 0);
+
+    if (current_worker == NULL || current_worker->pool != pool ||
+        !deque_push(&current_worker->deque, task))
+    {
+        run_task(task);
+        return;
+    }
+    pool_notify(pool);
+}
+
+void pool_join(pool_t *pool, task_t *task)
+{
+    worker_t *w = current_worker;
+    unsigned victim = w != NULL ? w->id + 1 : 0;
+
+    while (!atomic_load_explicit(&task->done, memory_order_acquire))
+    {
+        task_t *other = (w != NULL && w->pool == pool) ? find_task(w, &victim)
+                                                       : NULL;
+        if (other != NULL)
+        {
+            run_task(other);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+}
+
+int pool_default_size(void)
+{
+    char *env = getenv("NUM_THREADS");
+    if (env != NULL && atoi(env) > 0)
+    {
+        return atoi(env);
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (int)online : 1;
+}
@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * @file thread_pool.h
+ * @brief Fixed pool of worker threads with work stealing : every worker owns
+ * a Chase-Lev deque, pushes and pops its own tasks at the bottom, and steals
+ * from the top of the other deques when it runs out of work.
+ ******************************************************************************/
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdatomic.h>
+
+/**********************************************
+ * @brief A unit of work, owned by the thread that submits it
+ * @arg fn The function to run
+ * @arg arg Its argument
+ * @arg done Set once fn returned
+ * @arg next Link of the injection queue (pool_run)
+ *
+ * Tasks live on the stack of their submitter, which must pool_join them
+ * before returning.
+ ***********************************************/
+typedef struct Task
+{
+    void (*fn)(void *);
+    void *arg;
+    atomic_int done;
+    struct Task *next;
+} task_t;
+
+typedef struct Thread_pool pool_t;
+
+/**********************************************
+ * @brief Starts nb_workers threads, they live until pool_destroy
+ * @return The pool, NULL if it cannot be allocated or a thread cannot be
+ * started (errno is set)
+ ***********************************************/
+pool_t *pool_create(int nb_workers);
+
+/**********************************************
+ * @brief Stops and joins the workers, the pool must be idle
+ ***********************************************/
+void pool_destroy(pool_t *pool);
+
+/**********************************************
+ * @brief Number of workers of the pool
+ ***********************************************/
+int pool_size(pool_t *pool);
+
+/**********************************************
+ * @brief Runs fn(arg) on the pool and waits for it, from a thread that is
+ * not a worker (typically main)
+ ***********************************************/
+void pool_run(pool_t *pool, void (*fn)(void *), void *arg);
+
+/**********************************************
+ * @brief Pushes a task on the deque of the calling worker, where idle
+ * workers can steal it. Runs it right away if the deque is full.
+ *
+ * Only valid from a task running on the pool.
+ ***********************************************/
+void pool_submit(pool_t *pool, task_t *task, void (*fn)(void *), void *arg);
+
+/**********************************************
+ * @brief Waits for a submitted task, running other tasks in the meantime
+ ***********************************************/
+void pool_join(pool_t *pool, task_t *task);
+
+/**********************************************
+ * @brief Number of workers to start : the NUM_THREADS environment variable
+ * if set, the number of online processors otherwise
+ ***********************************************/
+int pool_default_size(void);
+
+#endif
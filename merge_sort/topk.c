@@ -0,0 +1,204 @@
+/*******************************************************************************
+ * @file topk.c
+ * @brief Selections of libpsort (selection.c) : the k smallest values, a
+ * partial sort, or the value of rank k, without sorting the whole array.
+ * Same files and types as the sort binaries.
+ *
+ ******************************************************************************/
+#include <getopt.h>
+#include <omp.h> // for omp_get_wtime
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "array_io.h"
+#include "psort.h"
+
+/**********************************************
+ * Selections of -m
+ ***********************************************/
+#define MODE_TOPK 0
+#define MODE_PARTIAL 1
+#define MODE_NTH 2
+
+int main(int argc, char *argv[])
+{
+    /**********************************************
+     * Initialization
+     ***********************************************/
+
+    // ./topk [-m mode] [-k k | -q quantile] [-s] [-f format] [-T type]
+    //        <input_file> <output_file>
+    int mode = MODE_TOPK;
+    long k = -1;
+    double quantile = -1;
+    int backend = PSORT_OPENMP;
+    int type = ARRAY_INT32;
+    struct option options[] = {{"mode", required_argument, NULL, 'm'},
+                               {"k", required_argument, NULL, 'k'},
+                               {"quantile", required_argument, NULL, 'q'},
+                               {"sequential", no_argument, NULL, 's'},
+                               {"format", required_argument, NULL, 'f'},
+                               {"type", required_argument, NULL, 'T'},
+                               {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "m:k:q:sf:T:", options, NULL)) !=
+           -1)
+    {
+        if (opt == 'm' && strcmp(optarg, "topk") == 0)
+        {
+            mode = MODE_TOPK;
+        }
+        else if (opt == 'm' && strcmp(optarg, "partial") == 0)
+        {
+            mode = MODE_PARTIAL;
+        }
+        else if (opt == 'm' && strcmp(optarg, "nth") == 0)
+        {
+            mode = MODE_NTH;
+        }
+        else if (opt == 'k' && (k = atol(optarg)) >= 0)
+        {
+            // number of values, or rank for nth
+        }
+        else if (opt == 'q' && (quantile = atof(optarg)) >= 0 &&
+                 quantile <= 1)
+        {
+            // k from the size of the array
+        }
+        else if (opt == 's')
+        {
+            backend = PSORT_SEQUENTIAL;
+        }
+        else if (opt == 'f' &&
+                 (array_format = parse_array_format(optarg)) >= 0)
+        {
+            // read_array and write_array
+        }
+        else if (opt == 'T' && (type = parse_array_type(optarg)) > 0)
+        {
+            // any type of the sorts
+        }
+        else
+        {
+            argc = 0; // prints the usage below
+            break;
+        }
+    }
+    int nb_args = argc - optind;
+    char **args = argv + optind;
+
+    if (nb_args != 2 || (k < 0) == (quantile < 0))
+    {
+        fprintf(stderr,
+                "Usage: %s [-m mode] (-k k | -q quantile) [-s] [-f format] "
+                "[-T type] <input_file> <output_file>\n",
+                argv[0]);
+        fprintf(stderr, "mode is topk (the k smallest values, sorted, "
+                        "default), partial (the whole array, its k smallest "
+                        "values sorted first) or nth (the value of rank k)\n");
+        fprintf(stderr, "quantile in [0, 1] gives k = quantile * n (rank "
+                        "quantile * (n - 1) for nth)\n");
+        fprintf(stderr, "-s/--sequential runs on one thread instead of all "
+                        "the OpenMP threads\n");
+        fprintf(stderr, "format is text, binary or auto (default, binary for "
+                        "a .bin file)\n");
+        fprintf(stderr, "type is int (default), int64, uint32, float, double "
+                        "or kv (key:value)\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (access(args[0], F_OK) == -1 || access(args[1], F_OK) == -1)
+    {
+        fprintf(stderr, "One of the given file does not exist\n");
+        exit(EXIT_FAILURE);
+    }
+    void *T;
+    int array_size;
+    read_array(args[0], NULL, type, &array_size, &T);
+
+    if (quantile >= 0)
+    {
+        k = mode == MODE_NTH ? quantile * (array_size - 1)
+                             : quantile * array_size;
+    }
+    if (k > array_size || (mode == MODE_NTH && k >= array_size))
+    {
+        fprintf(stderr, "k = %ld is out of the array of %d values\n", k,
+                array_size);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("\nNumber of threads: %d\n",
+           backend == PSORT_OPENMP ? omp_get_max_threads() : 1);
+    printf("n = %d, k = %ld\n", array_size, k);
+
+    /**********************************************
+     * Selection
+     ***********************************************/
+    size_t size = array_type_size(type);
+    void *out = mode == MODE_TOPK ? malloc((k > 0 ? k : 1) * size) : NULL;
+    if (mode == MODE_TOPK && out == NULL)
+    {
+        perror("malloc : out error");
+        exit(EXIT_FAILURE);
+    }
+
+    double start = omp_get_wtime();
+    int status;
+    if (mode == MODE_TOPK)
+    {
+        status = psort_top_k(T, array_size, k, out, type, backend, NULL);
+    }
+    else if (mode == MODE_PARTIAL)
+    {
+        status = psort_partial_sort(T, array_size, k, type, backend, NULL);
+    }
+    else
+    {
+        status = psort_nth_element(T, array_size, k, type, backend, NULL);
+    }
+    if (status != 0)
+    {
+        perror("selection error");
+        exit(EXIT_FAILURE);
+    }
+    double stop = omp_get_wtime();
+
+    /**********************************************
+     * Print and write the result
+     ***********************************************/
+    if (mode == MODE_TOPK)
+    {
+        if (type == ARRAY_INT32)
+        {
+            printf("The %ld smallest values:\n", k);
+            pretty_print_array(out, k);
+        }
+        write_array(args[1], type, k, out);
+        free(out);
+    }
+    else if (mode == MODE_PARTIAL)
+    {
+        if (type == ARRAY_INT32)
+        {
+            printf("After the partial sort:\n");
+            pretty_print_array(T, array_size);
+        }
+        write_array(args[1], type, array_size, T);
+    }
+    else
+    {
+        if (type == ARRAY_INT32)
+        {
+            printf("Value of rank %ld: %d\n", k, ((int *)T)[k]);
+        }
+        write_array(args[1], type, 1, (char *)T + k * size);
+    }
+    printf("\033[0;32m\nTime: %g s\n\033[0m", stop - start);
+
+    free_array(T);
+
+    exit(EXIT_SUCCESS);
+}
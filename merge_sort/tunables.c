@@ -0,0 +1,182 @@
+/*******************************************************************************
+ * @file tunables.c
+ * @brief Tunables of the sorts : leaf size, task cutoff and parallel merge
+ * cutoff
+ *
+ * At startup they take, in order, the compiled default, the value of the
+ * config file written by find_n, and the environment variable of the same
+ * name. They are defined here so that any program using them links this
+ * file, and its constructor, from libpsort.a.
+ ******************************************************************************/
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fusion.h"
+#include "leaf_sort.h"
+#include "psort.h"
+#include "sort_backends.h"
+
+int leaf_size = LEAF_SIZE;
+int parallel_merge_cutoff = PARALLEL_MERGE_CUTOFF;
+int task_cutoff = TASK_CUTOFF;
+
+/**********************************************
+ * @brief A tunable : its name in the config file, in upper case in the
+ * environment
+ ***********************************************/
+typedef struct Tunable
+{
+    const char *name;
+    const char *env;
+    int *value;
+} tunable_t;
+
+static const tunable_t tunables[] = {
+    {"leaf_size", "LEAF_SIZE", &leaf_size},
+    {"task_cutoff", "TASK_CUTOFF", &task_cutoff},
+    {"parallel_merge_cutoff", "PARALLEL_MERGE_CUTOFF", &parallel_merge_cutoff},
+};
+
+#define NB_TUNABLES (int)(sizeof(tunables) / sizeof(tunables[0]))
+
+/**********************************************
+ * @brief Parses a value of a tunable
+ * @return The value, or -1 if str is not a positive integer
+ ***********************************************/
+static int parse_value(const char *str)
+{
+    char *end;
+    errno = 0;
+    long value = strtol(str, &end, 10);
+    while (*end == ' ' || *end == '\t' || *end == '\n' || *end == '\r')
+    {
+        end++;
+    }
+    if (end == str || *end != '\0' || errno != 0 || value < 1 ||
+        value > INT32_MAX)
+    {
+        return -1;
+    }
+    return value;
+}
+
+const char *psort_config_path(void)
+{
+    static char path[4096];
+
+    char *env = getenv("PSORT_CONFIG");
+    if (env != NULL)
+    {
+        return env;
+    }
+    char *home = getenv("HOME");
+    if (home == NULL)
+    {
+        return NULL;
+    }
+    snprintf(path, sizeof(path), "%s/.psort.conf", home);
+    return path;
+}
+
+int psort_load_config(const char *path)
+{
+    if (path == NULL && (path = psort_config_path()) == NULL)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    char line[256];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        if (line[strspn(line, " \t\r\n")] == '\0')
+            continue; // blank line
+
+        char name[64];
+        char value[64];
+        int fields = sscanf(line, " %63[a-z_] = %63s", name, value);
+
+        int t = 0;
+        while (fields == 2 && t < NB_TUNABLES &&
+               strcmp(name, tunables[t].name) != 0)
+        {
+            t++;
+        }
+        int v = fields == 2 ? parse_value(value) : -1;
+        if (t == NB_TUNABLES || v < 1)
+        {
+            fprintf(stderr, "%s:%d : invalid line ignored\n", path,
+                    line_number);
+            continue;
+        }
+        *tunables[t].value = v;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+int psort_save_config(const char *path, const psort_opts_t *opts)
+{
+    if (path == NULL && (path = psort_config_path()) == NULL)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    int values[NB_TUNABLES] = {opts->leaf_size, opts->task_cutoff,
+                               opts->parallel_merge_cutoff};
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    fprintf(file, "# libpsort tunables, written by find_n\n");
+    for (int t = 0; t < NB_TUNABLES; t++)
+    {
+        fprintf(file, "%s = %d\n", tunables[t].name,
+                values[t] > 0 ? values[t] : *tunables[t].value);
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+/**********************************************
+ * @brief Reads the config file, if any, then the environment variables
+ ***********************************************/
+__attribute__((constructor)) static void tunables_init(void)
+{
+    psort_load_config(NULL); // a missing file keeps the defaults
+
+    for (int t = 0; t < NB_TUNABLES; t++)
+    {
+        char *env = getenv(tunables[t].env);
+        if (env == NULL)
+            continue;
+
+        int value = parse_value(env);
+        if (value < 1)
+        {
+            fprintf(stderr, "%s=%s ignored, using %d\n", tunables[t].env, env,
+                    *tunables[t].value);
+        }
+        else
+        {
+            *tunables[t].value = value;
+        }
+    }
+}
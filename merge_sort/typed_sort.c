@@ -0,0 +1,190 @@
+/*******************************************************************************
+ * @file typed_sort.c
+ * @brief Instances of typed_sort_impl.h for every element type other than
+ * int, the dispatch on the type code, and argsort on top of them
+ ******************************************************************************/
+#include <errno.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array_io.h"
+#include "fusion.h"
+#include "typed_sort.h"
+
+#define TYPE int64_t
+#define SUFFIX i64
+#define LESS(a, b) ((a) < (b))
+#include "typed_sort_impl.h"
+
+#define TYPE uint32_t
+#define SUFFIX u32
+#define LESS(a, b) ((a) < (b))
+#include "typed_sort_impl.h"
+
+#define TYPE uint64_t
+#define SUFFIX u64
+#define LESS(a, b) ((a) < (b))
+#include "typed_sort_impl.h"
+
+#define TYPE float
+#define SUFFIX f32
+#define LESS(a, b) (key_f32(a) < key_f32(b))
+#include "typed_sort_impl.h"
+
+#define TYPE double
+#define SUFFIX f64
+#define LESS(a, b) (key_f64(a) < key_f64(b))
+#include "typed_sort_impl.h"
+
+#define TYPE kv_t
+#define SUFFIX kv
+#define LESS(a, b) ((a).key < (b).key)
+#include "typed_sort_impl.h"
+
+int typed_sort_omp(void *tab, int n, int type, int task_cutoff)
+{
+    switch (type)
+    {
+    case ARRAY_INT64:
+        return tri_fusion_i64(tab, n, task_cutoff);
+    case ARRAY_UINT32:
+        return tri_fusion_u32(tab, n, task_cutoff);
+    case ARRAY_FLOAT:
+        return tri_fusion_f32(tab, n, task_cutoff);
+    case ARRAY_DOUBLE:
+        return tri_fusion_f64(tab, n, task_cutoff);
+    case ARRAY_KV:
+        return tri_fusion_kv(tab, n, task_cutoff);
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+int typed_is_sorted(const void *tab, int n, int type)
+{
+    switch (type)
+    {
+    case ARRAY_INT64:
+        return is_sorted_i64(tab, n);
+    case ARRAY_UINT32:
+        return is_sorted_u32(tab, n);
+    case ARRAY_FLOAT:
+        return is_sorted_f32(tab, n);
+    case ARRAY_DOUBLE:
+        return is_sorted_f64(tab, n);
+    case ARRAY_KV:
+        return is_sorted_kv(tab, n);
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+int typed_sort_seq(void *tab, int n, int type)
+{
+    return typed_sort_omp(tab, n, type, 0);
+}
+
+/**********************************************
+ * @brief Unsigned 32-bit key of the same order as keys[i]
+ ***********************************************/
+static inline uint32_t key_32(const void *keys, int i, int type)
+{
+    switch (type)
+    {
+    case ARRAY_INT32:
+        return (uint32_t)((const int *)keys)[i] ^ 0x80000000u;
+    case ARRAY_UINT32:
+        return ((const uint32_t *)keys)[i];
+    default: // ARRAY_FLOAT
+        return (uint32_t)key_f32(((const float *)keys)[i]) ^ 0x80000000u;
+    }
+}
+
+int argsort(const void *keys, int n, int type, uint32_t *perm,
+            int task_cutoff)
+{
+    int parallel = task_cutoff > 0;
+    int status = 0;
+
+    if (type == ARRAY_INT32 || type == ARRAY_UINT32 || type == ARRAY_FLOAT)
+    {
+        uint64_t *packed = malloc(n * sizeof(uint64_t));
+        if (packed == NULL)
+            return -1;
+#pragma omp parallel for if (parallel)
+        for (int i = 0; i < n; i++)
+        {
+            packed[i] = (uint64_t)key_32(keys, i, type) << 32 | (uint32_t)i;
+        }
+        // distinct values : stable whatever the order of the merges
+        status = tri_fusion_u64(packed, n, task_cutoff);
+#pragma omp parallel for if (parallel)
+        for (int i = 0; i < n; i++)
+        {
+            perm[i] = (uint32_t)packed[i];
+        }
+        free(packed);
+    }
+    else if (type == ARRAY_INT64 || type == ARRAY_DOUBLE)
+    {
+        kv_t *pairs = malloc(n * sizeof(kv_t));
+        if (pairs == NULL)
+            return -1;
+#pragma omp parallel for if (parallel)
+        for (int i = 0; i < n; i++)
+        {
+            pairs[i].key = type == ARRAY_INT64
+                               ? ((const int64_t *)keys)[i]
+                               : key_f64(((const double *)keys)[i]);
+            pairs[i].value = i;
+        }
+        status = tri_fusion_kv(pairs, n, task_cutoff); // stable
+#pragma omp parallel for if (parallel)
+        for (int i = 0; i < n; i++)
+        {
+            perm[i] = pairs[i].value;
+        }
+        free(pairs);
+    }
+    else
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return status;
+}
+
+void apply_permutation(const void *src, void *dst, int n, size_t size,
+                       const uint32_t *perm)
+{
+    // the common sizes get a load and a store instead of a memcpy call
+    if (size == 4)
+    {
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+        {
+            ((uint32_t *)dst)[i] = ((const uint32_t *)src)[perm[i]];
+        }
+    }
+    else if (size == 8)
+    {
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+        {
+            ((uint64_t *)dst)[i] = ((const uint64_t *)src)[perm[i]];
+        }
+    }
+    else
+    {
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+        {
+            memcpy((char *)dst + i * size, (const char *)src + perm[i] * size,
+                   size);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * @file typed_sort.h
+ * @brief Merge sort of the element types other than int : int64, uint32,
+ * float, double and (key, value) records
+ *
+ * The kernels are generated for every type from typed_sort_impl.h, each
+ * instance with its own comparison. The types are the ARRAY_* codes of
+ * array_io.h.
+ ******************************************************************************/
+#ifndef TYPED_SORT_H
+#define TYPED_SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**********************************************
+ * @brief A (key, value) record, sorted by key and moved whole
+ ***********************************************/
+typedef struct Kv
+{
+    int64_t key;
+    int64_t value;
+} kv_t;
+
+/**********************************************
+ * @brief Key of a float in the IEEE 754 total order, compared as a signed
+ * integer
+ *
+ * Positive floats already compare as their bits. For negative ones every
+ * bit but the sign is flipped, so that a larger magnitude gives a smaller
+ * key, and NaNs land beyond the infinities according to their sign.
+ ***********************************************/
+static inline int32_t key_f32(float x)
+{
+    int32_t b;
+    memcpy(&b, &x, sizeof(b));
+    return b ^ (int32_t)((uint32_t)(b >> 31) >> 1);
+}
+
+/**********************************************
+ * @brief Same as key_f32() for a double
+ ***********************************************/
+static inline int64_t key_f64(double x)
+{
+    int64_t b;
+    memcpy(&b, &x, sizeof(b));
+    return b ^ (int64_t)((uint64_t)(b >> 63) >> 1);
+}
+
+/**********************************************
+ * Size below which the typed sorts use insertion sort
+ ***********************************************/
+#define TYPED_LEAF 16
+
+/**********************************************
+ * @brief Sorts an array of the given type with sequential merge sort
+ * @param tab The array to sort
+ * @param n The size of the array
+ * @param type ARRAY_INT64, ARRAY_UINT32, ARRAY_FLOAT, ARRAY_DOUBLE or
+ * ARRAY_KV
+ *
+ * @return 0, or -1 if the scratch array cannot be allocated (tab
+ * unchanged) or type is not one of these (errno EINVAL)
+ *
+ * Floats and doubles follow the IEEE 754 total order : -NaN < -inf < ... <
+ * -0 < +0 < ... < +inf < +NaN. Records are sorted by key, stably.
+ ***********************************************/
+int typed_sort_seq(void *tab, int n, int type);
+
+/**********************************************
+ * @brief Same as typed_sort_seq() with OpenMP tasks, like tri_fusion in
+ * openmp.c
+ * @param task_cutoff Size below which a node is sorted without tasks
+ ***********************************************/
+int typed_sort_omp(void *tab, int n, int type, int task_cutoff);
+
+/**********************************************
+ * @brief 1 if tab is sorted in the order of typed_sort_seq(), -1 if type
+ * is not one of its types
+ ***********************************************/
+int typed_is_sorted(const void *tab, int n, int type);
+
+/**********************************************
+ * @brief Stable argsort : the permutation that sorts keys, keys unchanged
+ * @param keys The keys, of any type of typed_sort_seq() or ARRAY_INT32
+ * @param n The number of keys
+ * @param type The type of the keys
+ * @param perm The permutation, keys[perm[0]] <= keys[perm[1]] <= ... and
+ * equal keys in the order of their indices
+ * @param task_cutoff As for typed_sort_omp(), 0 for the sequential sort
+ * @return 0, or -1 if the pairs cannot be allocated
+ *
+ * Each key is turned into an integer of the same order and kept next to
+ * its index while sorting : 32-bit keys are packed with it in one uint64
+ * (key above index), 64-bit keys form a kv_t with it. The merges move
+ * these pairs and never gather keys through the indices.
+ ***********************************************/
+int argsort(const void *keys, int n, int type, uint32_t *perm,
+            int task_cutoff);
+
+/**********************************************
+ * @brief Reorders a column by a permutation, with all the threads
+ * @param src The column, n values of size bytes
+ * @param dst The reordered column, dst[i] = src[perm[i]], must not overlap
+ * src
+ * @param n The number of values
+ * @param size The size of a value
+ * @param perm The permutation, as given by argsort()
+ ***********************************************/
+void apply_permutation(const void *src, void *dst, int n, size_t size,
+                       const uint32_t *perm);
+
+#endif
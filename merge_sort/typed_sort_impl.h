@@ -0,0 +1,189 @@
+/*******************************************************************************
+ * @file typed_sort_impl.h
+ * @brief Template of the typed merge sorts, included once per type by
+ * typed_sort.c
+ *
+ * Before including it, define :
+ *  TYPE        the element type
+ *  SUFFIX      the suffix of the generated functions
+ *  LESS(a, b)  1 if a sorts strictly before b
+ *
+ * Same algorithms as the int sorts (ping-pong buffers, merge path slices),
+ * with a scalar merge and insertion sort at the leaves instead of the int
+ * SIMD kernels.
+ ******************************************************************************/
+
+#define CAT_(a, b) a##_##b
+#define CAT(a, b) CAT_(a, b)
+#define F(name) CAT(name, SUFFIX)
+
+/**********************************************
+ * @brief Merges two sorted arrays, equal keys taken from U first
+ ***********************************************/
+static void F(fusion)(const TYPE *U, int n, const TYPE *V, int m, TYPE *T)
+{
+    int i = 0, j = 0, k = 0;
+    while (i < n && j < m)
+    {
+        int take_v = LESS(V[j], U[i]);
+        T[k++] = take_v ? V[j] : U[i];
+        i += 1 - take_v;
+        j += take_v;
+    }
+    memcpy(T + k, U + i, (n - i) * sizeof(TYPE));
+    k += n - i;
+    memcpy(T + k, V + j, (m - j) * sizeof(TYPE));
+}
+
+/**********************************************
+ * @brief Co-rank of k in the merge of U and V, see co_rank() in fusion.c
+ ***********************************************/
+static int F(co_rank)(int k, const TYPE *U, int n, const TYPE *V, int m)
+{
+    int lo = (k > m) ? k - m : 0;
+    int hi = (k < n) ? k : n;
+    while (lo < hi)
+    {
+        int i = lo + (hi - lo) / 2;
+        if (LESS(V[k - i - 1], U[i]))
+        {
+            hi = i;
+        }
+        else
+        {
+            lo = i + 1;
+        }
+    }
+    return lo;
+}
+
+/**********************************************
+ * @brief Writes T[k0..k1-1] of the merge of U and V
+ ***********************************************/
+static void F(fusion_slice)(int k0, int k1, const TYPE *U, int n,
+                            const TYPE *V, int m, TYPE *T)
+{
+    int i0 = F(co_rank)(k0, U, n, V, m);
+    int i1 = F(co_rank)(k1, U, n, V, m);
+    F(fusion)(U + i0, i1 - i0, V + k0 - i0, (k1 - i1) - (k0 - i0), T + k0);
+}
+
+/**********************************************
+ * @brief Sorts an array using insertion sort, stable
+ ***********************************************/
+static void F(tri_insertion)(TYPE *tab, int n)
+{
+    for (int i = 1; i < n; i++)
+    {
+        TYPE x = tab[i];
+        int j = i;
+        while (j > 0 && LESS(x, tab[j - 1]))
+        {
+            tab[j] = tab[j - 1];
+            j--;
+        }
+        tab[j] = x;
+    }
+}
+
+/**********************************************
+ * @brief Sorts src into dst, src and dst holding the same values on entry
+ ***********************************************/
+static void F(tri_fusion_rec)(TYPE *src, TYPE *dst, int n)
+{
+    if (n <= TYPED_LEAF)
+    {
+        F(tri_insertion)(dst, n);
+        return;
+    }
+
+    int mid = n / 2;
+    F(tri_fusion_rec)(dst, src, mid);
+    F(tri_fusion_rec)(dst + mid, src + mid, n - mid);
+    F(fusion)(src, mid, src + mid, n - mid, dst);
+}
+
+/**********************************************
+ * @brief Same as tri_fusion_rec with OpenMP tasks above task_cutoff and
+ * merge path slices above parallel_merge_cutoff
+ ***********************************************/
+static void F(tri_fusion_task)(TYPE *src, TYPE *dst, int n, int task_cutoff)
+{
+    if (n <= task_cutoff)
+    {
+        F(tri_fusion_rec)(src, dst, n);
+        return;
+    }
+
+    int mid = n / 2;
+#pragma omp task
+    F(tri_fusion_task)(dst, src, mid, task_cutoff);
+    F(tri_fusion_task)(dst + mid, src + mid, n - mid, task_cutoff);
+#pragma omp taskwait
+
+    if (n >= parallel_merge_cutoff)
+    {
+        int p = omp_get_num_threads();
+#pragma omp taskloop grainsize(1)
+        for (int s = 0; s < p; s++)
+        {
+            int k0 = (long long)n * s / p;
+            int k1 = (long long)n * (s + 1) / p;
+            F(fusion_slice)(k0, k1, src, mid, src + mid, n - mid, dst);
+        }
+    }
+    else
+    {
+        F(fusion)(src, mid, src + mid, n - mid, dst);
+    }
+}
+
+/**********************************************
+ * @brief Sorts tab with one scratch buffer, sequentially or with tasks
+ * @param task_cutoff 0 for the sequential sort
+ * @return 0, or -1 if the buffer cannot be allocated (tab unchanged)
+ ***********************************************/
+static int F(tri_fusion)(TYPE *tab, int n, int task_cutoff)
+{
+    if (n < 2)
+        return 0;
+
+    TYPE *buf = malloc(n * sizeof(TYPE));
+    if (buf == NULL)
+        return -1;
+    memcpy(buf, tab, n * sizeof(TYPE));
+
+    if (task_cutoff <= 0)
+    {
+        F(tri_fusion_rec)(buf, tab, n);
+    }
+    else
+    {
+#pragma omp parallel
+#pragma omp single
+        F(tri_fusion_task)(buf, tab, n, task_cutoff);
+    }
+
+    free(buf);
+    return 0;
+}
+
+/**********************************************
+ * @brief 1 if tab is sorted
+ ***********************************************/
+static inline int F(is_sorted)(const TYPE *tab, int n)
+{
+    for (int i = 1; i < n; i++)
+    {
+        if (LESS(tab[i], tab[i - 1]))
+            return 0;
+    }
+    return 1;
+}
+
+#undef F
+#undef CAT
+#undef CAT_
+#undef TYPE
+#undef SUFFIX
+#undef LESS